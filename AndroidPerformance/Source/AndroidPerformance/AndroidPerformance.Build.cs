@@ -26,8 +26,12 @@ public class AndroidPerformance : ModuleRules
         PrivateDependencyModuleNames.AddRange(
             new string[]
             {
+                "Core",
+                "ApplicationCore",
+                "CoreUObject",
                 "Engine",
                 "RenderCore",
+                "RHI",
 
                 // ... add private dependencies that you statically link with here ...    
             }
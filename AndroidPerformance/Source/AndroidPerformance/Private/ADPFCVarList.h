@@ -0,0 +1,64 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_CVAR_LIST_H_
+#define ADPF_CVAR_LIST_H_
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+
+#include <type_traits>
+
+/*
+ * ADPFCVarList keeps the parsed entries of a comma separated list console
+ * variable, and parses it again when the variable changes. The per-frame
+ * paths read the entries without allocating. Declare it after its console
+ * variable, in the same file. Read it on the game thread.
+ */
+template <typename T>
+class ADPFCVarList {
+ public:
+    explicit ADPFCVarList(TAutoConsoleVariable<FString>& cvar) {
+        IConsoleVariable* variable = cvar.AsVariable();
+        Parse(variable);
+        variable->SetOnChangedCallback(FConsoleVariableDelegate::CreateRaw(this, &ADPFCVarList::Parse));
+    }
+
+    int32 Num() const { return entries_.Num(); }
+
+    // Entry at index, or default_value if the list is shorter.
+    T Get(int32 index, T default_value) const {
+        return entries_.IsValidIndex(index) ? entries_[index] : default_value;
+    }
+
+ private:
+    void Parse(IConsoleVariable* variable) {
+        TArray<FString> entries;
+        variable->GetString().ParseIntoArray(entries, TEXT(","));
+        entries_.Reset(entries.Num());
+        for (const FString& entry : entries) {
+            if constexpr (std::is_floating_point_v<T>) {
+                entries_.Add(static_cast<T>(FCString::Atof(*entry)));
+            } else {
+                entries_.Add(static_cast<T>(FCString::Atoi(*entry)));
+            }
+        }
+    }
+
+    TArray<T> entries_;
+};
+
+#endif    // ADPF_CVAR_LIST_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFDeviceProfile.h"
+#include "AndroidPerformanceLog.h"
+#include "Misc/ConfigCacheIni.h"
+
+static const TCHAR* const kSettingsSection = TEXT("AndroidPerformance");
+static const TCHAR* const kProfileSectionPrefix = TEXT("AndroidPerformanceDeviceProfile ");
+
+// Profile keys that map directly to a console variable.
+static const TCHAR* const kConsoleVariableKeys[][2] = {
+    { TEXT("QualityDownThresholds"), TEXT("r.AndroidPerformanceQualityDownThresholds") },
+    { TEXT("QualityUpThresholds"), TEXT("r.AndroidPerformanceQualityUpThresholds") },
+    { TEXT("QualityMinDwell"), TEXT("r.AndroidPerformanceQualityMinDwell") },
+    { TEXT("QualityCooldownConfirm"), TEXT("r.AndroidPerformanceQualityCooldownConfirm") },
+    { TEXT("QualityStepOrder"), TEXT("r.AndroidPerformanceQualityStepOrder") },
+    { TEXT("ThermalSampleInterval"), TEXT("r.AndroidPerformanceThermalSampleInterval") },
+    { TEXT("FrameRateCapEnabled"), TEXT("r.AndroidPerformanceFrameRateCapEnabled") },
+    { TEXT("FrameRateCaps"), TEXT("r.AndroidPerformanceFrameRateCaps") },
+    { TEXT("ThreadGroups"), TEXT("r.AndroidPerformanceThreadGroups") },
+    { TEXT("PowerEfficiencyThreadGroups"), TEXT("r.AndroidPerformancePowerEfficiencyThreadGroups") },
+};
+
+static void ParseList(const FString& value, TArray<FString>& out_entries) {
+    value.ParseIntoArray(out_entries, TEXT(","));
+    for (FString& entry : out_entries) {
+        entry.TrimStartAndEndInline();
+    }
+    out_entries.RemoveAll([](const FString& entry) { return entry.IsEmpty(); });
+}
+
+// Scalability groups in EADPFQualityGroup order. Missing entries keep the
+// group of the same single quality level.
+static Scalability::FQualityLevels ParseQualityLevel(const FString& value, int32 level) {
+    Scalability::FQualityLevels levels;
+    levels.SetFromSingleQualityLevel(level);
+
+    TArray<FString> entries;
+    ParseList(value, entries);
+    int32* const groups[] = {
+        &levels.ViewDistanceQuality, &levels.AntiAliasingQuality, &levels.ShadowQuality,
+        &levels.PostProcessQuality, &levels.TextureQuality, &levels.EffectsQuality,
+        &levels.FoliageQuality, &levels.ShadingQuality,
+    };
+    if (entries.Num() > 0) {
+        levels.ResolutionQuality = FCString::Atof(*entries[0]);
+    }
+    for (int32 i = 1; i < entries.Num() && i <= UE_ARRAY_COUNT(groups); ++i) {
+        *groups[i - 1] = FCString::Atoi(*entries[i]);
+    }
+    return levels;
+}
+
+static bool ContainsAny(const FString& value, const TArray<FString>& substrings) {
+    for (const FString& substring : substrings) {
+        if (value.Contains(substring, ESearchCase::IgnoreCase)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ADPFDeviceProfile::Matches(const FString& soc_model, const FString& gpu_family) const {
+    if (soc_models.Num() == 0 && gpu_families.Num() == 0) {
+        return true;
+    }
+    return ContainsAny(soc_model, soc_models) || ContainsAny(gpu_family, gpu_families);
+}
+
+void ADPFDeviceProfileTable::Load() {
+    profiles_.Reset();
+    if (GConfig == nullptr) {
+        return;
+    }
+
+    TArray<FString> names;
+    GConfig->GetArray(kSettingsSection, TEXT("DeviceProfiles"), names, GEngineIni);
+    for (const FString& name : names) {
+        const FString section = FString(kProfileSectionPrefix) + name;
+        if (!GConfig->DoesSectionExist(*section, GEngineIni)) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Missing device profile section [%s]."), *section);
+            continue;
+        }
+
+        ADPFDeviceProfile& profile = profiles_.AddDefaulted_GetRef();
+        profile.name = name;
+
+        FString value;
+        if (GConfig->GetString(*section, TEXT("SocModels"), value, GEngineIni)) {
+            ParseList(value, profile.soc_models);
+        }
+        if (GConfig->GetString(*section, TEXT("GpuFamilies"), value, GEngineIni)) {
+            ParseList(value, profile.gpu_families);
+        }
+        GConfig->GetFloat(*section, TEXT("UpdateInterval"), profile.update_interval, GEngineIni);
+
+        for (int32 i = 0; i < kMaxProfileQualityLevels; ++i) {
+            if (GConfig->GetString(*section, *FString::Printf(TEXT("QualityLevel%d"), i), value, GEngineIni)) {
+                profile.has_quality_level[i] = true;
+                profile.quality_levels[i] = ParseQualityLevel(value, i);
+            }
+        }
+
+        for (const auto& key : kConsoleVariableKeys) {
+            if (GConfig->GetString(*section, key[0], value, GEngineIni)) {
+                profile.console_variables.Emplace(key[1], value);
+            }
+        }
+    }
+}
+
+const ADPFDeviceProfile* ADPFDeviceProfileTable::Find(const FString& soc_model, const FString& gpu_family) const {
+    for (const ADPFDeviceProfile& profile : profiles_) {
+        if (profile.Matches(soc_model, gpu_family)) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_DEVICE_PROFILE_H_
+#define ADPF_DEVICE_PROFILE_H_
+
+#include "CoreMinimal.h"
+#include "Scalability.h"
+
+// Number of quality levels a profile can define.
+static constexpr int32 kMaxProfileQualityLevels = 4;
+
+// Governor settings of one device class, read from the engine ini:
+//
+// [AndroidPerformance]
+// +DeviceProfiles=Snapdragon8Gen2
+//
+// [AndroidPerformanceDeviceProfile Snapdragon8Gen2]
+// SocModels=SM8550,kalama
+// GpuFamilies=Adreno (TM) 740
+// QualityDownThresholds=0.80,0.90,0.97
+// QualityLevel0=50,0,0,0,0,0,0,0,0
+//
+// Every key is optional, a missing key keeps the plugin default.
+struct ADPFDeviceProfile {
+    FString name;
+    // Case insensitive substrings of the SoC model and GPU family, a profile
+    // without any matches every device.
+    TArray<FString> soc_models;
+    TArray<FString> gpu_families;
+
+    // Seconds between two quality level updates, 0 if unset.
+    float update_interval = 0.f;
+    // Scalability levels of each quality level, lowest first.
+    bool has_quality_level[kMaxProfileQualityLevels] = {};
+    Scalability::FQualityLevels quality_levels[kMaxProfileQualityLevels];
+    // Console variables set with device profile priority, e.g. thresholds,
+    // FPS caps and thread groups.
+    TArray<TPair<FString, FString>> console_variables;
+
+    bool Matches(const FString& soc_model, const FString& gpu_family) const;
+};
+
+/*
+ * ADPFDeviceProfileTable holds the device profiles of the engine ini. It's
+ * filled once at startup and never changes after that.
+ */
+class ADPFDeviceProfileTable {
+ public:
+    void Load();
+
+    // First profile matching the device, nullptr if none.
+    const ADPFDeviceProfile* Find(const FString& soc_model, const FString& gpu_family) const;
+
+ private:
+    TArray<ADPFDeviceProfile> profiles_;
+};
+
+#endif    // ADPF_DEVICE_PROFILE_H_
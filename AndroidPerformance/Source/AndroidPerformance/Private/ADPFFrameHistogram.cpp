@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFFrameHistogram.h"
+
+void ADPFFrameHistogram::Add(float frame_ms, bool jank) {
+    const int32 bucket = FMath::Clamp(static_cast<int32>(frame_ms / kFrameHistogramBucketMs), 0,
+            kFrameHistogramBuckets - 1);
+    buckets_[bucket]++;
+    frame_count_++;
+    if (jank) {
+        jank_count_++;
+    }
+}
+
+void ADPFFrameHistogram::Reset() {
+    FMemory::Memzero(buckets_);
+    frame_count_ = 0;
+    jank_count_ = 0;
+}
+
+float ADPFFrameHistogram::Percentile(float fraction) const {
+    if (frame_count_ == 0) {
+        return 0.f;
+    }
+    const uint64 rank = FMath::CeilToInt64(static_cast<double>(frame_count_) * fraction);
+    uint64 count = 0;
+    for (int32 i = 0; i < kFrameHistogramBuckets; ++i) {
+        count += buckets_[i];
+        if (count >= rank) {
+            return (i + 1) * kFrameHistogramBucketMs;
+        }
+    }
+    return kFrameHistogramBuckets * kFrameHistogramBucketMs;
+}
+
+ADPFFrameTimeStats ADPFFrameHistogram::GetStats() const {
+    ADPFFrameTimeStats stats;
+    stats.frame_count = frame_count_;
+    stats.jank_count = jank_count_;
+    stats.p50_ms = Percentile(0.50f);
+    stats.p95_ms = Percentile(0.95f);
+    stats.p99_ms = Percentile(0.99f);
+    return stats;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_FRAME_HISTOGRAM_H_
+#define ADPF_FRAME_HISTOGRAM_H_
+
+#include "CoreMinimal.h"
+
+// Frame times from 0 to 100 ms in 0.5 ms buckets, the last bucket also
+// counts every longer frame.
+static constexpr int32 kFrameHistogramBuckets = 200;
+static constexpr float kFrameHistogramBucketMs = 0.5f;
+
+// Summary of a frame time histogram. Percentiles are in milliseconds, 0 if
+// no frame was recorded.
+struct ADPFFrameTimeStats {
+    uint32 frame_count = 0;
+    uint32 jank_count = 0;
+    float p50_ms = 0.f;
+    float p95_ms = 0.f;
+    float p99_ms = 0.f;
+};
+
+/*
+ * ADPFFrameHistogram counts frame times in fixed buckets. Adding a frame
+ * never allocates.
+ */
+class ADPFFrameHistogram {
+ public:
+    ADPFFrameHistogram() { Reset(); }
+
+    void Add(float frame_ms, bool jank);
+    void Reset();
+
+    uint32 GetFrameCount() const { return frame_count_; }
+    ADPFFrameTimeStats GetStats() const;
+
+ private:
+    // Upper bound of the bucket holding the given fraction of the frames.
+    float Percentile(float fraction) const;
+
+    uint32 buckets_[kFrameHistogramBuckets];
+    uint32 frame_count_;
+    uint32 jank_count_;
+};
+
+#endif    // ADPF_FRAME_HISTOGRAM_H_
@@ -17,6 +17,16 @@
 #include "ADPFManager.h"
 #include "AndroidPerformanceLog.h"
 #include "RenderCore.h"
+#include "RHI.h"
+#include "RHICommandList.h"
+#include "RenderingThread.h"
+#include "Misc/App.h"
+#include "Stats/Stats.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "HAL/ThreadManager.h"
+#include "HAL/RunnableThread.h"
+#include "UObject/UObjectGlobals.h"
 
 #if PLATFORM_ANDROID
 #include "Android/AndroidApplication.h"
@@ -49,9 +59,288 @@ static TAutoConsoleVariable<int32> CVarAndroidPerformanceChangeQualites(
     TEXT("Choose how the thermal status adjusts the game's fidelity level.\n")
     TEXT(" 0: The system does not adjust any settings\n")
     TEXT(" 1: Settings are adjusted according to the thermal headroom\n")
-    TEXT(" 2: Settings are adjusted according to the thermal listener"),
+    TEXT(" 2: Settings are adjusted according to the thermal listener\n")
+    TEXT(" 3: Settings are adjusted according to the forecast thermal headroom\n")
+    TEXT(" 4: Settings are planned with the learned thermal model for the expected session length"),
     ECVF_RenderThreadSafe);
 
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceFrameRateCapEnabled(
+    TEXT("r.AndroidPerformanceFrameRateCapEnabled"),
+    0,
+    TEXT("Enable/disable lowering the max FPS and the display refresh rate as the thermal status rises.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceFrameRateCaps(
+    TEXT("r.AndroidPerformanceFrameRateCaps"),
+    TEXT("0,0,45,30,30,30,30"),
+    TEXT("Comma separated max FPS for each thermal status, from NONE to SHUTDOWN.\n")
+    TEXT("0 keeps the game's own max FPS. A cap never raises the game's own max FPS."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceFrameRateCaps(CVarAndroidPerformanceFrameRateCaps);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceThermalForecastHorizons(
+    TEXT("r.AndroidPerformanceThermalForecastHorizons"),
+    TEXT("0,3,10"),
+    TEXT("Comma separated thermal headroom forecast horizons in seconds, up to 60, sampled in\n")
+    TEXT("r.AndroidPerformanceChangeQualities=3 mode. The current headroom (0) is always sampled.\n")
+    TEXT("Read when the listener is registered."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceThermalForecastHorizons(CVarAndroidPerformanceThermalForecastHorizons);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformancePredictiveLookahead(
+    TEXT("r.AndroidPerformancePredictiveLookahead"),
+    10.0f,
+    TEXT("Seconds ahead the forecast headroom slope is extrapolated to, in r.AndroidPerformanceChangeQualities=3 mode."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceThreadGroups(
+    TEXT("r.AndroidPerformanceThreadGroups"),
+    TEXT("Game,Foreground Worker,TaskGraphThreadHP;Render;RHI"),
+    TEXT("Threads boosted together by one performance hint session. Groups are separated by ';' and entries by ','.\n")
+    TEXT("The first entry of a group is Game, Render or RHI, and that thread's frame duration is reported to the session.\n")
+    TEXT("The other entries are Game, Render, RHI or thread name prefixes, e.g. 'Foreground Worker'.\n")
+    TEXT("Read when the hint sessions are created."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceThreadGroupRescanInterval(
+    TEXT("r.AndroidPerformanceThreadGroupRescanInterval"),
+    5.0f,
+    TEXT("Interval in seconds to look for created or renamed threads of the thread groups.\n")
+    TEXT(" 0: off (disabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceStartupBoost(
+    TEXT("r.AndroidPerformanceStartupBoost"),
+    1,
+    TEXT("Enable/disable boosting the loading threads from startup until the first interactive frame, Android 13 and later.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)\n")
+    TEXT("Read at startup."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceStartupBoostThreads(
+    TEXT("r.AndroidPerformanceStartupBoostThreads"),
+    TEXT("Game,Foreground Worker,Background Worker,AsyncLoadingThread,IOThreadPool"),
+    TEXT("Comma separated threads of the startup boost session: Game, Render, RHI or thread name prefixes.\n")
+    TEXT("Read at startup."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceStartupBoostEnd(
+    TEXT("r.AndroidPerformanceStartupBoostEnd"),
+    0,
+    TEXT("First interactive frame that ends the startup boost.\n")
+    TEXT(" 0: the first frame after the first map load\n")
+    TEXT(" 1: the game calls UAndroidPerformanceFunctionLibrary::NotifyFirstInteractiveFrame()"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceStartupBoostTimeout(
+    TEXT("r.AndroidPerformanceStartupBoostTimeout"),
+    30.0f,
+    TEXT("Seconds after which the startup boost ends without a first interactive frame."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceAsyncSessionInit(
+    TEXT("r.AndroidPerformanceAsyncSessionInit"),
+    1,
+    TEXT("Create the performance hint sessions on a worker thread instead of the game thread.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformancePowerEfficiency(
+    TEXT("r.AndroidPerformancePowerEfficiency"),
+    1,
+    TEXT("Enable/disable the power efficiency sessions of r.AndroidPerformancePowerEfficiencyThreadGroups, Android 15 and later.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)\n")
+    TEXT("Read when the hint sessions are created."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformancePowerEfficiencyThreadGroups(
+    TEXT("r.AndroidPerformancePowerEfficiencyThreadGroups"),
+    TEXT("Background Worker,BackgroundThreadPool,IOThreadPool"),
+    TEXT("Threads that don't bound the frame time, e.g. streaming or background work. Each group gets a session that prefers\n")
+    TEXT("power efficiency over performance. Groups are separated by ';' and entries, thread name prefixes, by ','.\n")
+    TEXT("Keep the threads out of r.AndroidPerformanceThreadGroups. Read when the hint sessions are created."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceComputeHeadroom(
+    TEXT("r.AndroidPerformanceComputeHeadroom"),
+    1,
+    TEXT("Enable/disable sampling the CPU and GPU headroom on Android 16 and later. When lowering quality, the\n")
+    TEXT("scalability groups that cost the shorter resource are stepped first.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceBottleneckMargin(
+    TEXT("r.AndroidPerformanceBottleneckMargin"),
+    10.0f,
+    TEXT("Difference between the CPU and GPU headroom, from 0 to 100, above which the lower one is treated as the bottleneck."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceGameMode(
+    TEXT("r.AndroidPerformanceGameMode"),
+    1,
+    TEXT("Enable/disable following the game mode picked in the Game Dashboard, and reporting the loading state to the system.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceGameModeQualityCaps(
+    TEXT("r.AndroidPerformanceGameModeQualityCaps"),
+    TEXT("3,3,3,1,3"),
+    TEXT("Comma separated highest quality level for each game mode: UNSUPPORTED, STANDARD, PERFORMANCE, BATTERY, CUSTOM."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceGameModeQualityCaps(CVarAndroidPerformanceGameModeQualityCaps);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceGameModeFrameRateCaps(
+    TEXT("r.AndroidPerformanceGameModeFrameRateCaps"),
+    TEXT("0,0,0,30,0"),
+    TEXT("Comma separated max FPS for each game mode: UNSUPPORTED, STANDARD, PERFORMANCE, BATTERY, CUSTOM.\n")
+    TEXT("0 keeps the game's own max FPS. The lower of this and the thermal cap is used."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceGameModeFrameRateCaps(CVarAndroidPerformanceGameModeFrameRateCaps);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceGameModePowerEfficiency(
+    TEXT("r.AndroidPerformanceGameModePowerEfficiency"),
+    TEXT("0,0,0,1,0"),
+    TEXT("Comma separated 0/1 for each game mode: UNSUPPORTED, STANDARD, PERFORMANCE, BATTERY, CUSTOM.\n")
+    TEXT("1 makes the game, render and RHI thread sessions prefer power efficiency, Android 15 and later."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceGameModePowerEfficiency(CVarAndroidPerformanceGameModePowerEfficiency);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceLoadMapWorkloadHints(
+    TEXT("r.AndroidPerformanceLoadMapWorkloadHints"),
+    1,
+    TEXT("Enable/disable sending a workload increase hint when a map load starts and a reset hint when it ends.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceWorkloadBoostTargetScale(
+    TEXT("r.AndroidPerformanceWorkloadBoostTargetScale"),
+    0.5f,
+    TEXT("Scale of the target work duration while a workload hint is active, on devices without the Android 16 workload hints.\n")
+    TEXT("A lower value asks the system for more CPU performance. 1 disables the fallback."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceWorkloadBoostDuration(
+    TEXT("r.AndroidPerformanceWorkloadBoostDuration"),
+    5.0f,
+    TEXT("Seconds a workload increase hint tightens the target work duration, unless a reset hint comes first.\n")
+    TEXT("Only used on devices without the Android 16 workload hints."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceJankFactor(
+    TEXT("r.AndroidPerformanceJankFactor"),
+    2.0f,
+    TEXT("A frame longer than this many target frame durations counts as a jank in the frame time stats."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceBudgetHeadroomStart(
+    TEXT("r.AndroidPerformanceBudgetHeadroomStart"),
+    0.6f,
+    TEXT("Thermal headroom where the performance budget starts to fall. It reaches 0 at headroom 1."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceThermalModel(
+    TEXT("r.AndroidPerformanceThermalModel"),
+    1,
+    TEXT("Enable/disable learning how the thermal headroom moves under each quality level, and saving it between sessions.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformancePlanHorizon(
+    TEXT("r.AndroidPerformancePlanHorizon"),
+    1200.0f,
+    TEXT("Expected session length in seconds for the planned quality mode, counted from startup.\n")
+    TEXT("SetExpectedSessionLength() replaces it, e.g. at the start of a match."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformancePolicy(
+    TEXT("r.AndroidPerformancePolicy"),
+    TEXT(""),
+    TEXT("Name of a policy registered with FAndroidPerformancePolicyRegistry that replaces the built-in policy of\n")
+    TEXT("r.AndroidPerformanceChangeQualities. Empty uses the built-in policy."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceMemoryMonitor(
+    TEXT("r.AndroidPerformanceMemoryMonitor"),
+    1,
+    TEXT("Enable/disable lowering texture quality and the texture streaming pool under memory pressure.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceMemoryAvailThresholds(
+    TEXT("r.AndroidPerformanceMemoryAvailThresholds"),
+    TEXT("2.0,1.5,1.2"),
+    TEXT("Comma separated available memory, in multiples of the low memory threshold, below which the memory pressure\n")
+    TEXT("reaches level 1, 2 and 3. The onTrimMemory() level of the process can raise it further."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceMemoryAvailThresholds(CVarAndroidPerformanceMemoryAvailThresholds);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceMemoryQualityCaps(
+    TEXT("r.AndroidPerformanceMemoryQualityCaps"),
+    TEXT("3,3,2,1"),
+    TEXT("Comma separated highest quality level for each memory pressure level from 0 to 3."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<int32> ListAndroidPerformanceMemoryQualityCaps(CVarAndroidPerformanceMemoryQualityCaps);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceMemoryPoolScales(
+    TEXT("r.AndroidPerformanceMemoryPoolScales"),
+    TEXT("1.0,0.85,0.7,0.5"),
+    TEXT("Comma separated scale of r.Streaming.PoolSize for each memory pressure level from 0 to 3.\n")
+    TEXT("A pool size set from the console, the command line or a console variables ini is left alone."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceMemoryPoolScales(CVarAndroidPerformanceMemoryPoolScales);
+
+static FAutoConsoleCommand CmdAndroidPerformanceDumpFrameStats(
+    TEXT("r.AndroidPerformanceDumpFrameStats"),
+    TEXT("Log the frame time percentiles and jank count for each thermal status and quality level."),
+    FConsoleCommandDelegate::CreateLambda([]() { ADPFManager::getInstance().DumpFrameTimeStats(); }));
+
+static FAutoConsoleCommand CmdAndroidPerformanceDumpThermalModel(
+    TEXT("r.AndroidPerformanceDumpThermalModel"),
+    TEXT("Log the learned headroom response of each quality level."),
+    FConsoleCommandDelegate::CreateLambda([]() { ADPFManager::getInstance().DumpThermalModel(); }));
+
+static FAutoConsoleCommand CmdAndroidPerformanceResetThermalModel(
+    TEXT("r.AndroidPerformanceResetThermalModel"),
+    TEXT("Forget the learned thermal model of this device."),
+    FConsoleCommandDelegate::CreateLambda([]() { ADPFManager::getInstance().ResetThermalModel(); }));
+
+static FAutoConsoleCommand CmdAndroidPerformanceRecordThermalTrace(
+    TEXT("r.AndroidPerformanceRecordThermalTrace"),
+    TEXT("Record the thermal samples and frame timings to a trace file for replays.\n")
+    TEXT("Optional argument: file path, a new file in the profiling directory by default."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args) {
+        ADPFManager::getInstance().StartThermalTraceRecording(args.Num() > 0 ? args[0] : FString());
+    }));
+
+static FAutoConsoleCommand CmdAndroidPerformanceStopThermalTrace(
+    TEXT("r.AndroidPerformanceStopThermalTrace"),
+    TEXT("Stop recording the thermal trace."),
+    FConsoleCommandDelegate::CreateLambda([]() { ADPFManager::getInstance().StopThermalTraceRecording(); }));
+
+static FAutoConsoleCommand CmdAndroidPerformanceReplayThermalTrace(
+    TEXT("r.AndroidPerformanceReplayThermalTrace"),
+    TEXT("Play a thermal trace through the governor in place of the platform, one frame per engine frame.\n")
+    TEXT("Arguments: file path, then \"fast\" to run the whole trace at once."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args) {
+        if (args.Num() == 0) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("r.AndroidPerformanceReplayThermalTrace needs a trace file."));
+            return;
+        }
+        const bool fast = args.Num() > 1 && args[1].Equals(TEXT("fast"), ESearchCase::IgnoreCase);
+        ADPFManager::getInstance().StartThermalTraceReplay(args[0], fast);
+    }));
+
+#if PLATFORM_ANDROID
 // Native callback for thermal status change listener.
 // The function is called from Activity implementation in Java.
 void nativeThermalStatusChanged(JNIEnv *env, jclass cls, jint thermalState) {
@@ -82,48 +371,115 @@ void nativeUnregisterThermalStatusListener(JNIEnv *env, jclass cls) {
         UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal Status callback unregisterred:%d"), ret);
     }
 }
+#endif
 
-float Clock() {
-    static struct timespec _base;
-    static bool first_call = true;
+// Taken when the module is loaded, so that no sample is taken at 0.
+static const uint64 GADPFClockBaseCycles = FPlatformTime::Cycles64();
 
-    if (first_call) {
-        clock_gettime(CLOCK_MONOTONIC, &_base);
-        first_call = false;
-    }
+int64 Clock() {
+    return CyclesToNanos(FPlatformTime::Cycles64() - GADPFClockBaseCycles);
+}
 
-    struct timespec t;
-    clock_gettime(CLOCK_MONOTONIC, &t);
-    float sec_diff = (float)(t.tv_sec - _base.tv_sec);
-    float msec_diff = (float)((t.tv_nsec - _base.tv_nsec) / 1000000);
-    return sec_diff + 0.001f * msec_diff;
+// Learned thermal model of this device, kept with the saved data of the game.
+static FString GetThermalModelPath() {
+    return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AndroidPerformance"), TEXT("ThermalModel.bin"));
 }
 
 ADPFManager::ADPFManager()
         : thermal_manager_(nullptr),
             initialized_performance_hint_manager(false),
+            perfhint_sessions_ready_(false),
             thermal_status_(0),
+            thermal_event_queue_(kThermalEventQueueSize + 1),
+            dropped_thermal_events_(0),
+            thermal_history_count_(0),
+            thermal_history_next_(0),
             thermal_headroom_(0.f),
+            thermal_update_interval_(kThermalHeadroomUpdateThreshold),
             obj_power_service_(nullptr),
             get_thermal_headroom_(0),
+            perfhint_backend_(EPerfHintBackend::None),
+            perfhint_manager_(nullptr),
             obj_perfhint_service_(nullptr),
-            obj_perfhint_game_session_(nullptr),
-            obj_perfhint_render_session_(nullptr),
-            obj_perfhint_rhi_session_(nullptr),
-            report_actual_game_work_duration_(0),
-            report_actual_render_work_duration_(0),
-            report_actual_rhi_work_duration_(0),
-            update_target_game_work_duration_(0),
-            update_target_render_work_duration_(0),
-            update_target_rhi_work_duration_(0),
+            create_hint_session_(0),
+            perfhint_group_count_(0),
+            last_thread_scan_clock_(0),
+            gpu_reporting_thread_(EPerfHintThread::Render),
             preferred_update_rate_(0),
+            last_forecast_timestamp_ns_(0),
+            predicted_thermal_headroom_(0.f),
+            thermal_sampler_([this](ADPFThermalSnapshot& snapshot) { SampleThermalStatus(snapshot); }),
+            system_health_min_interval_(0.0),
+            obj_game_manager_(nullptr),
+            get_game_mode_(0),
+            set_game_state_(0),
+            cls_game_state_(nullptr),
+            game_state_ctor_(0),
+            game_mode_(-1),
+            obj_activity_manager_(nullptr),
+            cls_activity_manager_(nullptr),
+            get_memory_info_(0),
+            get_my_memory_state_(0),
+            obj_memory_info_(nullptr),
+            obj_process_info_(nullptr),
+            avail_mem_field_(0),
+            total_mem_field_(0),
+            threshold_field_(0),
+            low_memory_field_(0),
+            last_trim_level_field_(0),
+            memory_pressure_(0),
+            memory_quality_cap_(max_quality_count - 1),
+            memory_pressure_lower_since_(-1),
+            stale_trim_level_(-1),
+            base_streaming_pool_size_(-1),
+            base_streaming_pool_priority_(ECVF_SetByConstructor),
             current_quality_level(max_quality_count - 1),
             target_quality_level(max_quality_count - 1),
+            quality_governor_(max_quality_count),
+            thermal_model_(max_quality_count),
+            thermal_model_loaded_(false),
+            last_model_sample_timestamp_ns_(0),
+            plan_end_clock_(-1),
+            threshold_policy_(quality_governor_),
+            predictive_policy_(quality_governor_),
+            planned_policy_(quality_governor_, thermal_model_),
+            policy_selection_dirty_(true),
+            policy_frame_rate_cap_(INDEX_NONE),
+            policy_screen_percentage_(0.0f),
+            policy_target_scale_(0.0f),
             prev_max_fps(-1.0f),
-            prev_max_fps_nano(0),
+            frame_rate_cap_(0),
+            game_max_fps_(0.0f),
+            target_work_duration_ns_(16666666),
+            base_target_work_duration_ns_(16666666),
+            workload_boost_end_clock_(0),
+            startup_boost_start_clock_(0),
+            startup_boost_map_loaded_(false),
+            last_monitor_frame_(UINT64_MAX),
+            performance_budget_(1.0f),
+            broadcast_budget_(1.0f),
+            broadcast_quality_level_(max_quality_count - 1),
+            monitor_clock_(0),
+            quality_change_count_(0),
+            last_monitor_cost_ns_(0),
+            last_total_cost_ns_(0),
+            cost_frame_count_(0),
+            last_recorded_thermal_timestamp_ns_(-1),
+            last_recorded_thermal_status_(-1),
+            last_recorded_frame_interval_ns_(0),
+            replay_clock_(0),
+            replay_frame_count_(0),
+            replay_stopped_sampler_(false),
             fps_total(0.0f),
             fps_count(0){
     last_clock_ = Clock();
+    CVarAndroidPerformancePolicy.AsVariable()->SetOnChangedCallback(
+            FConsoleVariableDelegate::CreateLambda([this](IConsoleVariable*) { policy_selection_dirty_ = true; }));
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        perfhint_primary_groups_[i] = nullptr;
+        perfhint_primary_thread_ids_[i] = 0;
+        thread_target_work_duration_ns_[i].store(16666666, std::memory_order_relaxed);
+    }
 
     // Load current quality level, and set this quality level is maximum.
     Scalability::FQualityLevels current_level = Scalability::GetQualityLevels();
@@ -162,6 +518,14 @@ ADPFManager::ADPFManager()
 
 ADPFManager::~ADPFManager() {
 #if PLATFORM_ANDROID
+    if (perfhint_init_task_.IsValid()) {
+        perfhint_init_task_.Wait();
+    }
+
+    for (int32 i = 0; i < perfhint_group_count_; ++i) {
+        ReleasePerfHintSession(perfhint_groups_[i].session);
+    }
+
     // Remove global reference.
     if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
         if (obj_power_service_ != nullptr) {
@@ -170,11 +534,23 @@ ADPFManager::~ADPFManager() {
         if (obj_perfhint_service_ != nullptr) {
             env->DeleteGlobalRef(obj_perfhint_service_);
         }
-        if (obj_perfhint_game_session_ != nullptr) {
-            env->DeleteGlobalRef(obj_perfhint_game_session_);
+        if (obj_game_manager_ != nullptr) {
+            env->DeleteGlobalRef(obj_game_manager_);
+        }
+        if (cls_game_state_ != nullptr) {
+            env->DeleteGlobalRef(cls_game_state_);
+        }
+        if (obj_activity_manager_ != nullptr) {
+            env->DeleteGlobalRef(obj_activity_manager_);
         }
-        if (obj_perfhint_render_session_ != nullptr) {
-            env->DeleteGlobalRef(obj_perfhint_render_session_);
+        if (cls_activity_manager_ != nullptr) {
+            env->DeleteGlobalRef(cls_activity_manager_);
+        }
+        if (obj_memory_info_ != nullptr) {
+            env->DeleteGlobalRef(obj_memory_info_);
+        }
+        if (obj_process_info_ != nullptr) {
+            env->DeleteGlobalRef(obj_process_info_);
         }
         if (thermal_manager_ != nullptr) {
             AThermal_releaseManager(thermal_manager_);
@@ -183,6 +559,40 @@ ADPFManager::~ADPFManager() {
 #endif
 }
 
+void ADPFManager::LoadDeviceProfile() {
+    ADPFDeviceProfileTable profiles;
+    profiles.Load();
+
+#if PLATFORM_ANDROID
+    const FString soc_model = FAndroidMisc::GetCPUChipset();
+    const FString gpu_family = FAndroidMisc::GetGPUFamily();
+#else
+    const FString soc_model = FPlatformMisc::GetCPUBrand();
+    const FString gpu_family = FPlatformMisc::GetPrimaryGPUBrand();
+#endif
+    const ADPFDeviceProfile* profile = profiles.Find(soc_model, gpu_family);
+    if (profile == nullptr) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("No device profile for %s / %s"), *soc_model, *gpu_family);
+        return;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Device profile %s for %s / %s"), *profile->name, *soc_model, *gpu_family);
+
+    // Console and command line settings still win over the profile.
+    for (const TPair<FString, FString>& console_variable : profile->console_variables) {
+        if (IConsoleVariable* cvar = IConsoleManager::Get().FindConsoleVariable(*console_variable.Key)) {
+            cvar->Set(*console_variable.Value, ECVF_SetByDeviceProfile);
+        }
+    }
+    if (profile->update_interval > 0.f) {
+        thermal_update_interval_ = profile->update_interval;
+    }
+    for (int32 i = 0; i < FMath::Min(max_quality_count, kMaxProfileQualityLevels); ++i) {
+        if (profile->has_quality_level[i]) {
+            quality_levels[i] = profile->quality_levels[i];
+        }
+    }
+}
+
 bool ADPFManager::registerListener() {
 #if PLATFORM_ANDROID
     // Initialize PowerManager reference.
@@ -191,6 +601,17 @@ bool ADPFManager::registerListener() {
         return false;
     }
 
+    // Decide once which performance hint backend is used, so the per frame
+    // path doesn't need to check the API level.
+    SelectPerformanceHintBackend();
+
+    if (!thermal_model_loaded_) {
+        thermal_model_loaded_ = true;
+        if (thermal_model_.Load(GetThermalModelPath())) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Loaded the thermal model %s"), *GetThermalModelPath());
+        }
+    }
+
     // Retrieve power manager and register thermal state change callback.
     if (android_get_device_api_level() >= 30) {
         // Use NDK Thermal API.
@@ -199,6 +620,18 @@ bool ADPFManager::registerListener() {
             auto ret = AThermal_registerThermalStatusListener(manager, thermal_callback,
                                                             nullptr);
             UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal Status callback registerred:%d"), ret);
+
+            // Poll the headroom off the game thread from now on.
+            InitializeSystemHealth();
+            InitializeGameManager();
+            InitializeMemoryMonitor();
+            ADPFThermalSnapshot initial_snapshot;
+            initial_snapshot.headroom = thermal_headroom_;
+            initial_snapshot.status = thermal_status_;
+            initial_snapshot.game_mode = QueryGameMode();
+            initial_snapshot.timestamp_ns = Clock();
+            ParseThermalForecastHorizons(initial_snapshot);
+            thermal_sampler_.Start(initial_snapshot);
             return true;
         }
     }
@@ -210,6 +643,12 @@ bool ADPFManager::registerListener() {
 
 bool ADPFManager::unregisterListener() {
 #if PLATFORM_ANDROID
+    DumpFrameTimeStats();
+    SaveThermalModel();
+    thermal_trace_recorder_.Stop();
+    startup_boost_.Shutdown();
+    thermal_sampler_.Shutdown();
+
     // Remove the thermal state change listener on pause.
     if (android_get_device_api_level() >= 30) {
         // Use NDK Thermal API.
@@ -227,248 +666,750 @@ bool ADPFManager::unregisterListener() {
 // Invoke the method periodically (once a frame) to monitor
 // the device's thermal throttling status.
 void ADPFManager::Monitor() {
-#if PLATFORM_ANDROID
     if (CVarAndroidPerformanceEnabled.GetValueOnAnyThread() == 0) {
         return;
     }
 
-    // for debug
-    extern ENGINE_API float GAverageFPS;
-    fps_total += GAverageFPS;
-    fps_count++;
-
-    // Change graphic quality by theraml.
-    float current_clock = Clock();
-    if (current_clock - last_clock_ >= kThermalHeadroomUpdateThreshold) {
-        // Update thermal headroom.
-        UpdateThermalStatusHeadRoom();
-        last_clock_ = current_clock;
+    // Run once per frame.
+    if (last_monitor_frame_ == GFrameCounter) {
+        return;
+    }
+    last_monitor_frame_ = GFrameCounter;
+    RecordCost();
+    ADPF_SCOPE(Monitor);
 
-        // for debug
-        UE_LOG(LogAndroidPerformance, Log, TEXT("Headroom %.3f %d FPS %.2f temp %.2f"), thermal_headroom_, thermal_status_,
-                fps_total / (float)fps_count, FAndroidMisc::GetDeviceTemperatureLevel());
-        fps_total = 0.0f;
-        fps_count = 0;
+    // A replay stands in for the platform, on any platform.
+    if (thermal_trace_reader_.IsOpen()) {
+        ReplayThermalTraceFrame();
+        return;
+    }
 
-        const int32 quality_mode = CVarAndroidPerformanceChangeQualites.GetValueOnAnyThread();
-        if (quality_mode != 0) {
-            if (quality_mode == 1) {
-                saveQualityLevel(thermal_headroom_);
-            }
-            else {
-                saveQualityLevel(max_quality_count - thermal_status_ - 1);
-            }
+#if PLATFORM_ANDROID
+    const int64 current_clock = Clock();
+    const float frame_ms = static_cast<float>(FApp::GetDeltaTime() * 1000.0);
+    int64 work_duration_ns = 0;
+    for (const std::atomic<int64>& duration : last_work_duration_ns_) {
+        work_duration_ns = FMath::Max(work_duration_ns, duration.load(std::memory_order_relaxed));
+    }
 
-            // TODO Change the quality and FPS settings to match the game's status.
-            uint32_t new_target = target_quality_level;
-            if(current_quality_level != new_target) {
-                if(new_target > max_quality_count) {
-                    new_target = max_quality_count - 1;
-                }
-                current_quality_level = new_target;
+    UpdateGovernor(current_clock, frame_ms, work_duration_ns);
 
-                // Change Unreal scalability quality.
-                // https://docs.unrealengine.com/4.27/en-US/TestingAndOptimization/PerformanceAndProfiling/Scalability/ScalabilityReference/
-                UE_LOG(LogAndroidPerformance, Log, TEXT("Change quality level to %d"), new_target);
-                SetQualityLevels(quality_levels[new_target], true);
-            }
+    if (thermal_trace_recorder_.IsRecording()) {
+        const ADPFThermalSnapshot thermal_snapshot = thermal_sampler_.GetSnapshot();
+        if (thermal_snapshot.timestamp_ns != last_recorded_thermal_timestamp_ns_ ||
+                thermal_status_ != last_recorded_thermal_status_) {
+            last_recorded_thermal_timestamp_ns_ = thermal_snapshot.timestamp_ns;
+            last_recorded_thermal_status_ = thermal_status_;
+            thermal_trace_recorder_.RecordThermal(thermal_snapshot, thermal_status_);
+        }
+        if (target_controller_.GetFrameIntervalNs() != last_recorded_frame_interval_ns_) {
+            last_recorded_frame_interval_ns_ = target_controller_.GetFrameIntervalNs();
+            thermal_trace_recorder_.RecordFrameInterval(last_recorded_frame_interval_ns_);
         }
+        thermal_trace_recorder_.RecordFrame(frame_ms, work_duration_ns * 1e-6f);
     }
 
     // Hint manager logic based on current FPS and actual thread time.
     if (CVarAndroidPerformanceHintEnabled.GetValueOnAnyThread() != 0) {
+        // A recreated render or RHI thread leaves its session boosting a
+        // thread that no longer exists.
+        if (initialized_performance_hint_manager && PrimaryThreadsChanged()) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Primary thread recreated, rebuilding the perf hint sessions."));
+            ClosePerfHintSessions();
+        }
+
         // Initialize PowerHintManager reference on here, when
         // StartupModule is called render thread id is changed.
-        if (initialized_performance_hint_manager == false) {
+        // The startup boost hands over to the normal sessions once it ends.
+        if (initialized_performance_hint_manager == false && !startup_boost_.IsRunning()) {
             initialized_performance_hint_manager = true;
-            InitializePerformanceHintManager();
+            StartPerfHintSessions();
         }
 
-        // Check max fps is changed, and caluate nanosec duration
-        bool update_target_duration = false;
-        if(prev_max_fps != GEngine->GetMaxFPS()) {
-            prev_max_fps = GEngine->GetMaxFPS();
-            update_target_duration = true;
-            prev_max_fps_nano = prev_max_fps == 0.0f ? 16666666 : fpsToNanosec(prev_max_fps);
+        // Hand the sessions created on the worker to the reporting threads.
+        if (perfhint_init_task_.IsValid() && perfhint_init_task_.IsCompleted()) {
+            FinishPerfHintSessions();
         }
 
-        // Update hint session.
-        if(GGameThreadTime > 0) {
-            UpdatePerfHintSession(static_cast<jlong>(GGameThreadTime * 1000), prev_max_fps_nano, update_target_duration,
-                    obj_perfhint_game_session_, report_actual_game_work_duration_, update_target_game_work_duration_);
+        // Check max fps is changed, and caluate nanosec duration. The frame
+        // hooks send the new target with their next report.
+        if(prev_max_fps != GEngine->GetMaxFPS()) {
+            SetTargetWorkDuration(GEngine->GetMaxFPS());
         }
-        else {
-            prev_max_fps = -1.0f;
+
+        const float rescan_interval = CVarAndroidPerformanceThreadGroupRescanInterval.GetValueOnAnyThread();
+        if (rescan_interval > 0.0f && current_clock - last_thread_scan_clock_ >= SecondsToNanos(rescan_interval) &&
+                !perfhint_init_task_.IsValid()) {
+            last_thread_scan_clock_ = current_clock;
+            RescanThreadGroups();
         }
-        UpdatePerfHintSession(static_cast<jlong>(GRenderThreadTime * 1000), prev_max_fps_nano, update_target_duration,
-                obj_perfhint_render_session_, report_actual_render_work_duration_, update_target_render_work_duration_);
-        UpdatePerfHintSession(static_cast<jlong>(GRHIThreadTime * 1000), prev_max_fps_nano, update_target_duration,
-                obj_perfhint_rhi_session_, report_actual_rhi_work_duration_, update_target_rhi_work_duration_);
+    } else if (initialized_performance_hint_manager) {
+        ClosePerfHintSessions();
     }
 #endif
 }
 
-void ADPFManager::SetThermalStatus(int32_t i){
-    thermal_status_ = i;
+// Device temperature level for the log, -1 outside Android.
+static float GetDeviceTemperature() {
+#if PLATFORM_ANDROID
+    return FAndroidMisc::GetDeviceTemperatureLevel();
+#else
+    return -1.0f;
+#endif
 }
 
-// Initialize JNI calls for the powermanager.
-bool ADPFManager::InitializePowerManager() {
-#if PLATFORM_ANDROID
-    if (android_get_device_api_level() >= 31) {
-        // Initialize the powermanager using NDK API.
-        thermal_manager_ = AThermal_acquireManager();
-    } else {
-        return false;
-    }
+// Everything Monitor() does that doesn't talk to the hint sessions. A replay
+// calls it with the recorded frames and its own clock.
+void ADPFManager::UpdateGovernor(int64 current_clock, float frame_ms, int64 work_duration_ns) {
+    monitor_clock_ = current_clock;
 
-    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
-        // Retrieve class information
-        jclass context = env->FindClass("android/content/Context");
+    // for debug
+    if (frame_ms > 0.0f) {
+        fps_total += 1000.0f / frame_ms;
+        fps_count++;
+    }
 
-        // Get the value of a constant
-        jfieldID fid =
-                env->GetStaticFieldID(context, "POWER_SERVICE", "Ljava/lang/String;");
-        jobject str_svc = env->GetStaticObjectField(context, fid);
+    DrainThermalStatusEvents();
+    RecordFrameTime(frame_ms);
 
-        // Get the method 'getSystemService' and call it
-        extern struct android_app* GNativeAndroidApp;
-        jmethodID mid_getss = env->GetMethodID(
-                context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
-        jobject obj_power_service = env->CallObjectMethod(
-                GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+    // Follow the game mode picked in the Game Dashboard.
+    const int32 game_mode = CVarAndroidPerformanceGameMode.GetValueOnAnyThread() != 0 ?
+            thermal_sampler_.GetSnapshot().game_mode : 0;
+    if (game_mode != game_mode_) {
+        ApplyGameMode(game_mode);
+    }
 
-        // Add global reference to the power service object.
-        obj_power_service_ = env->NewGlobalRef(obj_power_service);
+    UpdateMemoryPressure(current_clock);
+    LearnThermalModel();
 
-        jclass cls_power_service = env->GetObjectClass(obj_power_service_);
-        get_thermal_headroom_ =
-                env->GetMethodID(cls_power_service, "getThermalHeadroom", "(I)F");
+    const bool severe_throttling = thermal_status_ >= ATHERMAL_STATUS_SEVERE;
+    const ADPFThermalSnapshot thermal_snapshot = thermal_sampler_.GetSnapshot();
 
-        // Free references
-        env->DeleteLocalRef(cls_power_service);
-        env->DeleteLocalRef(obj_power_service);
-        env->DeleteLocalRef(str_svc);
-        env->DeleteLocalRef(context);
+    // Re-evaluate the forecasts with each new sample.
+    const bool new_thermal_sample = thermal_snapshot.timestamp_ns != last_forecast_timestamp_ns_;
+    if (new_thermal_sample) {
+        last_forecast_timestamp_ns_ = thermal_snapshot.timestamp_ns;
+        predicted_thermal_headroom_ = PredictThermalHeadroom(thermal_snapshot);
+    }
 
-        // Remove exception
-        if(env->ExceptionCheck()) {
-            env->ExceptionDescribe();
-            env->ExceptionClear();
+    // Periodic quality update.
+    const bool update_due = current_clock - last_clock_ >= SecondsToNanos(thermal_update_interval_);
+    if (update_due) {
+        // Read the thermal headroom last sampled by the sampler thread.
+        if (thermal_snapshot.timestamp_ns > 0) {
+            thermal_headroom_ = thermal_snapshot.headroom;
         }
+        last_clock_ = current_clock;
+
+        // for debug
+        const ADPFFrameTimeStats frame_stats = interval_frame_histogram_.GetStats();
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Headroom %.3f %d CPU %.1f GPU %.1f FPS %.2f P95 %.1f P99 %.1f ms jank %u temp %.2f"),
+                thermal_headroom_, thermal_status_, thermal_snapshot.cpu_headroom, thermal_snapshot.gpu_headroom,
+                fps_total / (float)FMath::Max(fps_count, 1), frame_stats.p95_ms, frame_stats.p99_ms,
+                frame_stats.jank_count, GetDeviceTemperature());
+        fps_total = 0.0f;
+        fps_count = 0;
+        interval_frame_histogram_.Reset();
     }
-#endif
 
-    if (get_thermal_headroom_ == 0) {
-        // The API is not supported in the platform version.
-        return false;
+    FAndroidPerformancePolicyInput input;
+    input.Clock = NanosToSeconds(current_clock);
+    input.FrameMs = frame_ms;
+    input.FPS = frame_ms > 0.0f ? 1000.0f / frame_ms : 0.0f;
+    input.WorkDurationNs = work_duration_ns;
+    input.TargetWorkDurationNs = target_work_duration_ns_.load(std::memory_order_relaxed);
+    input.FrameIntervalNs = target_controller_.GetFrameIntervalNs();
+    input.MissRate = target_controller_.GetMissRate();
+    input.ThermalHeadroom = thermal_snapshot.timestamp_ns > 0 ? thermal_snapshot.headroom : thermal_headroom_;
+    input.PredictedHeadroom = predicted_thermal_headroom_;
+    input.ThermalStatus = thermal_status_;
+    input.CPUHeadroom = thermal_snapshot.cpu_headroom;
+    input.GPUHeadroom = thermal_snapshot.gpu_headroom;
+    input.MemoryPressure = memory_pressure_;
+    input.QualityLevel = current_quality_level;
+    input.QualityLevelCount = max_quality_count;
+    input.MaxQualityLevel = FMath::Min(GetQualityCap(), max_quality_count - 1);
+    input.FrameRateCap = frame_rate_cap_;
+    input.ScreenPercentage = resolution_controller_.GetScreenPercentage();
+    input.RemainingSessionSeconds = GetRemainingSessionSeconds();
+    input.bNewThermalSample = new_thermal_sample;
+    input.bUpdateDue = update_due;
+
+    FAndroidPerformancePolicyDecision decision;
+    EvaluatePolicy(input, decision);
+    ApplyPolicyDecision(decision, severe_throttling);
+
+    // A replay doesn't change the live frame rate or boost.
+    if (!IsReplayingThermalTrace()) {
+        UpdateFrameRateCap();
+
+        if (startup_boost_.IsRunning()) {
+            UpdateStartupBoost(current_clock);
+        }
     }
 
-    if(FMath::IsNaN(UpdateThermalStatusHeadRoom())) {
-        // If thermal headroom is NaN, this device is not support thermal API.
-        return false;
+    // Follow the present interval and the missed deadline rate.
+    if (target_controller_.Tick(frame_ms, frame_ms * 0.001f)) {
+        base_target_work_duration_ns_ = target_controller_.GetFrameIntervalNs();
+        ApplyTargetWorkDuration();
     }
 
-    return true;
-}
+    // End the target tightening of an expired workload hint.
+    if (workload_boost_end_clock_ > 0 && current_clock >= workload_boost_end_clock_) {
+        workload_boost_end_clock_ = 0;
+        ApplyTargetWorkDuration();
+    }
 
-// Retrieve current thermal headroom using JNI call.
-float ADPFManager::UpdateThermalStatusHeadRoom() {
-#if __ANDROID_API__ >= 31
-    // Use NDK API to retrieve thermal status headroom.
-    thermal_headroom_ = AThermal_getThermalHeadroom(
-            thermal_manager_, kThermalHeadroomForecastSeconds);
-    return thermal_headroom_;
-#endif
+    // Apply the next scalability group change of a level transition.
+    quality_ladder_.Tick();
+    UpdatePerformanceBudget();
 
-    if (get_thermal_headroom_ == 0) {
-        return 0.f;
-    }
+    ADPF_RECORD_VALUE(ThermalHeadroom, thermal_snapshot.headroom);
+    ADPF_RECORD_VALUE(CPUHeadroom, thermal_snapshot.cpu_headroom);
+    ADPF_RECORD_VALUE(GPUHeadroom, thermal_snapshot.gpu_headroom);
+    ADPF_RECORD_VALUE(ThermalStatus, thermal_status_);
+    ADPF_RECORD_VALUE(QualityLevel, current_quality_level);
+    ADPF_RECORD_VALUE(TargetWork, target_work_duration_ns_.load(std::memory_order_relaxed) * 1e-6);
+    ADPF_RECORD_VALUE(MissRate, target_controller_.GetMissRate());
+    ADPF_RECORD_VALUE(PerformanceBudget, GetPerformanceBudget());
+    ADPF_RECORD_VALUE(MemoryPressure, memory_pressure_);
 
-#if PLATFORM_ANDROID
-    // Get thermal headroom!
-    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
-        thermal_headroom_ =
-                env->CallFloatMethod(obj_power_service_, get_thermal_headroom_,
-                                                        kThermalHeadroomForecastSeconds);
+    // Absorb short term load with the screen percentage, unless the policy
+    // sets it. Each thread is held to its share of the present interval, not
+    // to the tightened hint target, so the PID loop and the resolution don't
+    // both react to the same miss. The thread furthest over its share drives
+    // the resolution. Traces only record the longest duration, so a replay
+    // holds it to the whole interval.
+    int64 resolution_work_ns = work_duration_ns;
+    int64 resolution_target_ns = base_target_work_duration_ns_;
+    double worst_load = -1.0;
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count) && !IsReplayingThermalTrace(); ++i) {
+        const int64 share_ns = static_cast<int64>(base_target_work_duration_ns_ * ADPFTargetController::GetBudgetShare(i));
+        const int64 duration_ns = last_work_duration_ns_[i].load(std::memory_order_relaxed);
+        const double load = share_ns > 0 ? static_cast<double>(duration_ns) / share_ns : 0.0;
+        if (duration_ns > 0 && load > worst_load) {
+            worst_load = load;
+            resolution_work_ns = duration_ns;
+            resolution_target_ns = share_ns;
+        }
     }
-#endif
-    return thermal_headroom_;
+    resolution_controller_.Tick(resolution_work_ns, resolution_target_ns,
+            thermal_snapshot.headroom, frame_ms * 0.001f, quality_ladder_.GetQualityLevels().ResolutionQuality,
+            policy_screen_percentage_);
 }
 
-// Initialize JNI calls for the PowerHintManager.
-bool ADPFManager::InitializePerformanceHintManager() {
-#if PLATFORM_ANDROID
-    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
-        // Retrieve class information
-        jclass context = env->FindClass("android/content/Context");
 
-        // Get the value of a constant
-        jfieldID fid = env->GetStaticFieldID(context, "PERFORMANCE_HINT_SERVICE",
-                                             "Ljava/lang/String;");
-        if(!fid) {
-            // Remove exception
-            if(env->ExceptionCheck()) {
-                env->ExceptionDescribe();
-                env->ExceptionClear();
-            }
-            return false;
-        }
-        jobject str_svc = env->GetStaticObjectField(context, fid);
 
-        // Get the method 'getSystemService' and call it
-        extern struct android_app* GNativeAndroidApp;
-        jmethodID mid_getss = env->GetMethodID(
-                context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
-        jobject obj_perfhint_service = env->CallObjectMethod(
-                GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+void ADPFManager::RegisterFrameHooks() {
+    FCoreDelegates::OnBeginFrame.AddRaw(this, &ADPFManager::OnBeginFrame);
+    FCoreDelegates::OnEndFrame.AddRaw(this, &ADPFManager::OnEndFrame);
+    FCoreDelegates::OnBeginFrameRT.AddRaw(this, &ADPFManager::OnBeginFrameRT);
+    FCoreDelegates::OnEndFrameRT.AddRaw(this, &ADPFManager::OnEndFrameRT);
+}
 
-        // Add global reference to the power service object.
-        obj_perfhint_service_ = env->NewGlobalRef(obj_perfhint_service);
+void ADPFManager::UnregisterFrameHooks() {
+    FCoreDelegates::OnBeginFrame.RemoveAll(this);
+    FCoreDelegates::OnEndFrame.RemoveAll(this);
+    FCoreDelegates::OnBeginFrameRT.RemoveAll(this);
+    FCoreDelegates::OnEndFrameRT.RemoveAll(this);
+}
 
-        // Retrieve methods IDs for the APIs.
-        jclass cls_perfhint_service = env->GetObjectClass(obj_perfhint_service_);
-        jmethodID mid_createhintsession =
-                env->GetMethodID(cls_perfhint_service, "createHintSession",
-                                 "([IJ)Landroid/os/PerformanceHintManager$Session;");
-        jmethodID mid_preferedupdaterate = env->GetMethodID(
-                cls_perfhint_service, "getPreferredUpdateRateNanos", "()J");
-        
-        const jlong DEFAULT_TARGET_NS = 16666666;
-
-        // Function to create and initialize a hint session
-        auto CreateHintSession = [&](int32_t threadId, jobject& sessionGlobalRef, jmethodID& reportMethod, jmethodID& updateMethod) {
-            jintArray array = env->NewIntArray(1);
-            env->SetIntArrayRegion(array, 0, 1, &threadId); 
-
-            jobject obj_hintsession = env->CallObjectMethod(obj_perfhint_service_, mid_createhintsession, array, DEFAULT_TARGET_NS);
-            if (obj_hintsession) {
-                sessionGlobalRef = env->NewGlobalRef(obj_hintsession);
-                preferred_update_rate_ = env->CallLongMethod(obj_perfhint_service_, mid_preferedupdaterate);
-
-                jclass cls_perfhint_session = env->GetObjectClass(obj_hintsession);
-                reportMethod = env->GetMethodID(cls_perfhint_session, "reportActualWorkDuration", "(J)V");
-                updateMethod = env->GetMethodID(cls_perfhint_session, "updateTargetWorkDuration", "(J)V");
-            } else {
-                UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to create a perf hint session."));
+bool ADPFManager::IsReportingEnabled() const {
+    return CVarAndroidPerformanceEnabled.GetValueOnAnyThread() != 0 &&
+            CVarAndroidPerformanceHintEnabled.GetValueOnAnyThread() != 0 &&
+            perfhint_sessions_ready_.load(std::memory_order_acquire);
+}
+
+void ADPFManager::ReportWorkDuration(EPerfHintThread thread, int64 duration_ns, int64 start_timestamp_ns) {
+    PerfHintThreadGroup* group = perfhint_primary_groups_[static_cast<int32>(thread)];
+    if (group == nullptr || duration_ns <= 0) {
+        return;
+    }
+    ADPF_SCOPE(ReportWorkDuration);
+
+    // Apply a thread list change from the game thread.
+    if (group->has_pending_thread_ids.load(std::memory_order_acquire)) {
+        TArray<int32> thread_ids;
+        {
+            FScopeLock lock(&group->pending_lock);
+            thread_ids = MoveTemp(group->pending_thread_ids);
+            group->has_pending_thread_ids.store(false, std::memory_order_relaxed);
+        }
+        SetPerfHintSessionThreads(thread_ids, group->session, group->prefer_power_efficiency);
+    }
+
+    // Apply a game mode change from the game thread.
+    const int32 power_efficiency = group->pending_power_efficiency.exchange(-1, std::memory_order_acquire);
+    if (power_efficiency >= 0) {
+        group->prefer_power_efficiency = power_efficiency != 0;
+        const ADPFNativeApi& api = ADPFNativeApi::Get();
+        if (group->session.native_session != nullptr && api.set_prefer_power_efficiency != nullptr) {
+            api.set_prefer_power_efficiency(group->session.native_session, group->prefer_power_efficiency);
+        }
+    }
+
+    SendPendingWorkloadHints(*group);
+
+    PerfHintSession& session = group->session;
+    const int64 target_duration_ns = thread_target_work_duration_ns_[static_cast<int32>(thread)].load(std::memory_order_relaxed);
+    const bool update_target_duration = session.reported_target_duration_ns != target_duration_ns;
+    session.reported_target_duration_ns = target_duration_ns;
+
+    // Last frame's GPU time, so the system can tell GPU bound frames apart.
+    int64 gpu_duration_ns = 0;
+    if (thread == gpu_reporting_thread_) {
+        gpu_duration_ns = CyclesToNanos(RHIGetGPUFrameCycles());
+    }
+    UpdatePerfHintSession(duration_ns, target_duration_ns, update_target_duration, session,
+            start_timestamp_ns, gpu_duration_ns);
+
+    switch (thread) {
+        case EPerfHintThread::Game:
+            ADPF_RECORD_VALUE(GameWork, duration_ns * 1e-6);
+            break;
+        case EPerfHintThread::Render:
+            ADPF_RECORD_VALUE(RenderWork, duration_ns * 1e-6);
+            break;
+        case EPerfHintThread::RHI:
+            ADPF_RECORD_VALUE(RHIWork, duration_ns * 1e-6);
+            break;
+        default:
+            break;
+    }
+    if (thread == gpu_reporting_thread_) {
+        ADPF_RECORD_VALUE(GPUWork, gpu_duration_ns * 1e-6);
+    }
+}
+
+void ADPFManager::OnWorkMeasured(EPerfHintThread thread, int64 duration_ns, int64 start_timestamp_ns) {
+    last_work_duration_ns_[static_cast<int32>(thread)].store(duration_ns, std::memory_order_relaxed);
+    if (IsReportingEnabled()) {
+        ReportWorkDuration(thread, duration_ns, start_timestamp_ns);
+    }
+}
+
+// Cycles the calling thread has waited on events and tasks since the engine
+// last reset its idle stats. This covers the game thread's frame end sync and
+// the task graph waits of the render and RHI threads.
+static uint32 GetThreadIdleCycles() {
+    return FThreadIdleStats::Get().Waits;
+}
+
+// The render thread also counts its GPU query and present waits apart.
+static uint32 GetRenderThreadIdleCycles() {
+    return GetThreadIdleCycles()
+        + GRenderThreadIdle[ERenderThreadIdleTypes::WaitingForGPUQuery]
+        + GRenderThreadIdle[ERenderThreadIdleTypes::WaitingForGPUPresent];
+}
+
+void ADPFManager::OnBeginFrame() {
+    game_frame_timer_.Start(GetThreadIdleCycles());
+}
+
+void ADPFManager::OnEndFrame() {
+    if (!game_frame_timer_.IsRunning()) {
+        return;
+    }
+    // The max FPS sleep is normally counted as an idle wait too, and
+    // FApp::GetIdleTime() covers it where it isn't.
+    const int64 sleep_ns = static_cast<int64>(FApp::GetIdleTime() * 1e9);
+    const int64 duration_ns = game_frame_timer_.Stop(GetThreadIdleCycles(), sleep_ns);
+    OnWorkMeasured(EPerfHintThread::Game, duration_ns, game_frame_timer_.start_timestamp_ns);
+}
+
+void ADPFManager::OnBeginFrameRT() {
+    render_frame_timer_.Start(GetRenderThreadIdleCycles());
+
+    // Without a dedicated RHI thread the commands run on the render thread,
+    // and its session already covers the work.
+    if (IsRunningRHIInSeparateThread()) {
+        FRHICommandListExecutor::GetImmediateCommandList().EnqueueLambda([this](FRHICommandListImmediate&) {
+            rhi_frame_timer_.Start(GetThreadIdleCycles());
+        });
+    }
+}
+
+void ADPFManager::OnEndFrameRT() {
+    if (IsRunningRHIInSeparateThread()) {
+        FRHICommandListExecutor::GetImmediateCommandList().EnqueueLambda([this](FRHICommandListImmediate&) {
+            if (rhi_frame_timer_.IsRunning()) {
+                const int64 duration_ns = rhi_frame_timer_.Stop(GetThreadIdleCycles());
+                OnWorkMeasured(EPerfHintThread::RHI, duration_ns, rhi_frame_timer_.start_timestamp_ns);
             }
+        });
+    }
 
-            env->DeleteLocalRef(obj_hintsession);
-            env->DeleteLocalRef(array);
-        };
+    if (render_frame_timer_.IsRunning()) {
+        const int64 duration_ns = render_frame_timer_.Stop(GetRenderThreadIdleCycles());
+        OnWorkMeasured(EPerfHintThread::Render, duration_ns, render_frame_timer_.start_timestamp_ns);
+    }
+}
 
-PRAGMA_DISABLE_DEPRECATION_WARNINGS
-        CreateHintSession(GGameThreadId, obj_perfhint_game_session_,
-                report_actual_game_work_duration_, update_target_game_work_duration_);
-        CreateHintSession(GRenderThreadId, obj_perfhint_render_session_,
-                report_actual_render_work_duration_, update_target_render_work_duration_);
-        CreateHintSession(GRHIThreadId, obj_perfhint_rhi_session_,
-                report_actual_rhi_work_duration_, update_target_rhi_work_duration_);
-PRAGMA_ENABLE_DEPRECATION_WARNINGS
+void ADPFManager::SetThermalStatus(int32_t i){
+    ADPFThermalEvent event;
+    event.status = i;
+    event.timestamp_ns = Clock();
 
-        // Free local references
-        env->DeleteLocalRef(cls_perfhint_service);
-        env->DeleteLocalRef(obj_perfhint_service);
+    FScopeLock lock(&thermal_event_producer_lock_);
+    if (!thermal_event_queue_.Enqueue(event)) {
+        dropped_thermal_events_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ADPFManager::DrainThermalStatusEvents() {
+    ADPFThermalEvent event;
+    while (thermal_event_queue_.Dequeue(event)) {
+        event.frame = GFrameCounter;
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal status %d -> %d at %.3f, applied at frame %llu"),
+                thermal_status_, event.status, NanosToSeconds(event.timestamp_ns), event.frame);
+        ADPF_RECORD_EVENT(TEXT("ADPF thermal status %d"), event.status);
+        thermal_status_ = event.status;
+
+        thermal_history_[thermal_history_next_] = event;
+        thermal_history_next_ = (thermal_history_next_ + 1) % kThermalHistorySize;
+        thermal_history_count_ = FMath::Min(thermal_history_count_ + 1, kThermalHistorySize);
+    }
+
+    const uint32 dropped = dropped_thermal_events_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Dropped %u thermal status events."), dropped);
+    }
+}
+
+void ADPFManager::GetThermalStatusHistory(TArray<ADPFThermalEvent>& out_history) const {
+    out_history.Reset(thermal_history_count_);
+    const int32 first = (thermal_history_next_ - thermal_history_count_ + kThermalHistorySize) % kThermalHistorySize;
+    for (int32 i = 0; i < thermal_history_count_; ++i) {
+        out_history.Add(thermal_history_[(first + i) % kThermalHistorySize]);
+    }
+}
+
+void ADPFManager::RecordFrameTime(float frame_ms) {
+    if (frame_ms <= 0.0f) {
+        return;
+    }
+
+    const bool jank = frame_ms > GetJankThresholdMs();
+    const int32 status = FMath::Clamp(thermal_status_, 0, kFrameHistogramThermalStatusCount - 1);
+    frame_histograms_[status][current_quality_level].Add(frame_ms, jank);
+    interval_frame_histogram_.Add(frame_ms, jank);
+}
+
+// The lower of what the quality level and the thermal headroom leave.
+void ADPFManager::UpdatePerformanceBudget() {
+    const ADPFThermalSnapshot snapshot = thermal_sampler_.GetSnapshot();
+    float thermal_budget = 1.0f;
+    if (snapshot.timestamp_ns > 0) {
+        const float start = FMath::Clamp(CVarAndroidPerformanceBudgetHeadroomStart.GetValueOnGameThread(), 0.0f, 0.99f);
+        thermal_budget = 1.0f - FMath::Clamp((snapshot.headroom - start) / (1.0f - start), 0.0f, 1.0f);
+    }
+    const float quality_budget = static_cast<float>(current_quality_level + 1) / max_quality_count;
+    const float budget = FMath::Min(thermal_budget, quality_budget);
+    // The game keeps the live budget during a replay.
+    if (IsReplayingThermalTrace()) {
+        return;
+    }
+    performance_budget_.store(budget, std::memory_order_relaxed);
+
+    if (current_quality_level != broadcast_quality_level_ || FMath::Abs(budget - broadcast_budget_) >= kBudgetBroadcastStep ||
+            (budget != broadcast_budget_ && (budget == 0.0f || budget == 1.0f))) {
+        broadcast_quality_level_ = current_quality_level;
+        broadcast_budget_ = budget;
+        on_budget_changed_.Broadcast(current_quality_level, budget);
+    }
+}
+
+// Judged against the frame rate the game asks for, not a boosted target.
+float ADPFManager::GetJankThresholdMs() const {
+    return base_target_work_duration_ns_ * 1e-6f * CVarAndroidPerformanceJankFactor.GetValueOnGameThread();
+}
+
+bool ADPFManager::GetFrameTimeStats(int32 thermal_status, int32 quality_level, ADPFFrameTimeStats& out_stats) const {
+    if (thermal_status < 0 || thermal_status >= kFrameHistogramThermalStatusCount ||
+            quality_level < 0 || quality_level >= max_quality_count) {
+        return false;
+    }
+    out_stats = frame_histograms_[thermal_status][quality_level].GetStats();
+    return true;
+}
+
+// Publish the cost counters accumulated since the last call, which is the
+// previous frame's cost on every thread.
+void ADPFManager::RecordCost() {
+    const int64 monitor_cost_ns = ADPFCostCounters::GetNanos(EADPFCost::Monitor);
+    const int64 total_cost_ns = ADPFCostCounters::GetTotalNanos();
+    ADPF_RECORD_VALUE(MonitorCost, (monitor_cost_ns - last_monitor_cost_ns_) * 1e-6);
+    ADPF_RECORD_VALUE(TotalCost, (total_cost_ns - last_total_cost_ns_) * 1e-6);
+    last_monitor_cost_ns_ = monitor_cost_ns;
+    last_total_cost_ns_ = total_cost_ns;
+    cost_frame_count_++;
+}
+
+void ADPFManager::DumpFrameTimeStats() const {
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Frame time stats, jank above %.1fx the target frame duration:"),
+            CVarAndroidPerformanceJankFactor.GetValueOnGameThread());
+    for (int32 status = 0; status < kFrameHistogramThermalStatusCount; ++status) {
+        for (int32 level = 0; level < max_quality_count; ++level) {
+            const ADPFFrameHistogram& histogram = frame_histograms_[status][level];
+            if (histogram.GetFrameCount() == 0) {
+                continue;
+            }
+            const ADPFFrameTimeStats stats = histogram.GetStats();
+            UE_LOG(LogAndroidPerformance, Log, TEXT("  Status %d quality %d: %u frames P50 %.1f P95 %.1f P99 %.1f ms jank %u (%.2f%%)"),
+                    status, level, stats.frame_count, stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.jank_count,
+                    100.0f * stats.jank_count / stats.frame_count);
+        }
+    }
+
+    if (cost_frame_count_ == 0) {
+        return;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Cost per frame over %llu frames: total %.3f ms"),
+            cost_frame_count_, ADPFCostCounters::GetTotalNanos() * 1e-6 / cost_frame_count_);
+    for (int32 i = 0; i < static_cast<int32>(EADPFCost::Count); ++i) {
+        const EADPFCost cost = static_cast<EADPFCost>(i);
+        const int64 calls = ADPFCostCounters::GetCalls(cost);
+        if (calls == 0) {
+            continue;
+        }
+        UE_LOG(LogAndroidPerformance, Log, TEXT("  %s: %.3f ms, %.2f calls, %.1f us per call"),
+                ADPFCostCounters::GetName(cost), ADPFCostCounters::GetNanos(cost) * 1e-6 / cost_frame_count_,
+                static_cast<double>(calls) / cost_frame_count_, ADPFCostCounters::GetNanos(cost) * 1e-3 / calls);
+    }
+}
+
+bool ADPFManager::StartThermalTraceRecording(const FString& path) {
+    const FString trace_path = !path.IsEmpty() ? path : FPaths::Combine(FPaths::ProfilingDir(), TEXT("AndroidPerformance"),
+            FString::Printf(TEXT("ThermalTrace-%s.adpftrace"), *FDateTime::Now().ToString()));
+    // The first Monitor() call records the current thermal state.
+    last_recorded_thermal_timestamp_ns_ = -1;
+    last_recorded_thermal_status_ = -1;
+    last_recorded_frame_interval_ns_ = 0;
+    return thermal_trace_recorder_.Start(trace_path);
+}
+
+void ADPFManager::StopThermalTraceRecording() {
+    thermal_trace_recorder_.Stop();
+}
+
+bool ADPFManager::StartThermalTraceReplay(const FString& path, bool fast) {
+    if (thermal_trace_reader_.IsOpen()) {
+        FinishThermalTraceReplay();
+    }
+    if (!thermal_trace_reader_.Open(path)) {
+        return false;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Replaying the thermal trace %s recorded on %s."), *path,
+            *thermal_trace_reader_.GetDevice());
+
+    // The sampler thread would overwrite the replayed samples.
+    replay_stopped_sampler_ = thermal_sampler_.IsRunning();
+    replay_saved_snapshot_ = thermal_sampler_.GetSnapshot();
+    if (replay_stopped_sampler_) {
+        thermal_sampler_.Shutdown();
+    }
+
+    ReplaySavedState& saved = replay_saved_state_;
+    saved.thermal_status = thermal_status_;
+    saved.thermal_headroom = thermal_headroom_;
+    saved.game_mode = game_mode_;
+    saved.game_mode_profile = game_mode_profile_;
+    saved.memory_pressure = memory_pressure_;
+    saved.memory_quality_cap = memory_quality_cap_;
+    saved.current_quality_level = current_quality_level;
+    saved.target_quality_level = target_quality_level;
+    saved.quality_governor = quality_governor_;
+    saved.quality_ladder = quality_ladder_;
+    saved.base_target_work_duration_ns = base_target_work_duration_ns_;
+    saved.target_controller = target_controller_;
+    saved.resolution_controller = resolution_controller_;
+    ResetGovernorForReplay();
+
+    if (fast) {
+        while (ReplayThermalTraceFrame()) {
+        }
+    }
+    return true;
+}
+
+void ADPFManager::RestoreDefaultQuality() {
+    if (memory_pressure_ != 0) {
+        ApplyMemoryPressure(0);
+    }
+    memory_pressure_lower_since_ = -1;
+    quality_governor_ = ADPFQualityGovernor(max_quality_count);
+    current_quality_level = max_quality_count - 1;
+    target_quality_level = max_quality_count - 1;
+    // The ladder is left settled on the same levels.
+    quality_ladder_.SetTarget(quality_levels[current_quality_level], false);
+    Scalability::SetQualityLevels(quality_levels[current_quality_level], true);
+    quality_ladder_.Tick();
+
+#if PLATFORM_ANDROID
+    if (frame_rate_cap_ > 0) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Restore max FPS %.1f"), game_max_fps_);
+        frame_rate_cap_ = 0;
+        GEngine->SetMaxFPS(game_max_fps_);
+
+        const ADPFNativeApi& api = ADPFNativeApi::Get();
+        extern struct android_app* GNativeAndroidApp;
+        if (api.native_window_set_frame_rate != nullptr && GNativeAndroidApp != nullptr && GNativeAndroidApp->window != nullptr) {
+            api.native_window_set_frame_rate(GNativeAndroidApp->window, 0.0f, 0);
+        }
+        SetTargetWorkDuration(game_max_fps_);
+    }
+#endif
+}
+
+// Start from the state of a new session, so that replays of the same trace
+// with the same settings make the same decisions.
+void ADPFManager::ResetGovernorForReplay() {
+    ADPFThermalEvent event;
+    while (thermal_event_queue_.Dequeue(event)) {
+    }
+    thermal_status_ = ATHERMAL_STATUS_NONE;
+    thermal_headroom_ = 0.0f;
+    thermal_sampler_.Publish(ADPFThermalSnapshot());
+    last_forecast_timestamp_ns_ = 0;
+    predicted_thermal_headroom_ = 0.0f;
+
+    game_mode_ = -1;
+    game_mode_profile_ = ADPFGameModeProfile();
+    ResetPolicyOverrides();
+    memory_pressure_ = 0;
+    memory_quality_cap_ = max_quality_count - 1;
+    memory_pressure_lower_since_ = -1;
+
+    // Every controller starts fresh. The ladder and the resolution
+    // controller change copies of the settings instead of the engine's, and
+    // the target follows the recorded frame interval.
+    quality_governor_ = ADPFQualityGovernor(max_quality_count);
+    current_quality_level = max_quality_count - 1;
+    target_quality_level = max_quality_count - 1;
+    quality_ladder_ = ADPFQualityLadder();
+    quality_ladder_.StartDryRun(quality_levels[current_quality_level]);
+    resolution_controller_ = ADPFResolutionController();
+    resolution_controller_.StartDryRun();
+    target_controller_ = ADPFTargetController();
+    base_target_work_duration_ns_ = target_controller_.GetFrameIntervalNs();
+    ApplyTargetWorkDuration();
+    quality_change_count_ = 0;
+
+    for (int32 status = 0; status < kFrameHistogramThermalStatusCount; ++status) {
+        for (int32 level = 0; level < max_quality_count; ++level) {
+            frame_histograms_[status][level].Reset();
+        }
+    }
+    interval_frame_histogram_.Reset();
+    fps_total = 0.0f;
+    fps_count = 0;
+
+    replay_clock_ = 0;
+    replay_frame_count_ = 0;
+    last_clock_ = 0;
+    plan_end_clock_ = -1;
+}
+
+bool ADPFManager::ReplayThermalTraceFrame() {
+    ADPFThermalTraceFrame frame;
+    if (!thermal_trace_reader_.Next(frame)) {
+        FinishThermalTraceReplay();
+        return false;
+    }
+    replay_clock_ += static_cast<int64>(frame.frame_ms * 1000000.0f);
+    replay_frame_count_++;
+
+    // Only the trace sets the thermal status, a live status change is
+    // dropped.
+    ADPFThermalEvent live_event;
+    while (thermal_event_queue_.Dequeue(live_event)) {
+    }
+    if (frame.thermal_changed) {
+        ADPFThermalSnapshot snapshot = frame.thermal;
+        snapshot.timestamp_ns = replay_clock_;
+        thermal_sampler_.Publish(snapshot);
+        if (snapshot.status != thermal_status_) {
+            SetThermalStatus(snapshot.status);
+        }
+    }
+    target_controller_.SetFrameIntervalOverride(frame.frame_interval_ns);
+
+    UpdateGovernor(replay_clock_, frame.frame_ms, static_cast<int64>(frame.work_ms * 1000000.0f));
+    return true;
+}
+
+void ADPFManager::FinishThermalTraceReplay() {
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal trace replay finished: %u frames, %.1fs, %u quality changes, final level %d."),
+            replay_frame_count_, NanosToSeconds(replay_clock_), quality_change_count_, current_quality_level);
+    DumpFrameTimeStats();
+    thermal_trace_reader_.Close();
+
+    if (replay_stopped_sampler_) {
+        replay_stopped_sampler_ = false;
+        thermal_sampler_.Start(replay_saved_snapshot_);
+    } else {
+        thermal_sampler_.Publish(replay_saved_snapshot_);
+    }
+
+    // Back to the live state and the real clock.
+    const ReplaySavedState& saved = replay_saved_state_;
+    thermal_status_ = saved.thermal_status;
+    thermal_headroom_ = saved.thermal_headroom;
+    last_forecast_timestamp_ns_ = 0;
+    game_mode_ = saved.game_mode;
+    game_mode_profile_ = saved.game_mode_profile;
+    memory_pressure_ = saved.memory_pressure;
+    memory_quality_cap_ = saved.memory_quality_cap;
+    memory_pressure_lower_since_ = -1;
+    current_quality_level = saved.current_quality_level;
+    target_quality_level = saved.target_quality_level;
+    quality_governor_ = saved.quality_governor;
+    quality_ladder_ = saved.quality_ladder;
+    base_target_work_duration_ns_ = saved.base_target_work_duration_ns;
+    target_controller_ = saved.target_controller;
+    resolution_controller_ = saved.resolution_controller;
+    ResetPolicyOverrides();
+    ApplyTargetWorkDuration();
+    last_clock_ = Clock();
+    plan_end_clock_ = -1;
+}
+
+// Initialize JNI calls for the powermanager.
+bool ADPFManager::InitializePowerManager() {
+#if PLATFORM_ANDROID
+    if (android_get_device_api_level() >= 31) {
+        // Initialize the powermanager using NDK API.
+        thermal_manager_ = AThermal_acquireManager();
+    } else {
+        return false;
+    }
+
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        // Retrieve class information
+        jclass context = env->FindClass("android/content/Context");
+
+        // Get the value of a constant
+        jfieldID fid =
+                env->GetStaticFieldID(context, "POWER_SERVICE", "Ljava/lang/String;");
+        jobject str_svc = env->GetStaticObjectField(context, fid);
+
+        // Get the method 'getSystemService' and call it
+        extern struct android_app* GNativeAndroidApp;
+        jmethodID mid_getss = env->GetMethodID(
+                context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+        jobject obj_power_service = env->CallObjectMethod(
+                GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+
+        // Add global reference to the power service object.
+        obj_power_service_ = env->NewGlobalRef(obj_power_service);
+
+        jclass cls_power_service = env->GetObjectClass(obj_power_service_);
+        get_thermal_headroom_ =
+                env->GetMethodID(cls_power_service, "getThermalHeadroom", "(I)F");
+
+        // Free references
+        env->DeleteLocalRef(cls_power_service);
+        env->DeleteLocalRef(obj_power_service);
         env->DeleteLocalRef(str_svc);
         env->DeleteLocalRef(context);
 
@@ -480,60 +1421,1595 @@ PRAGMA_ENABLE_DEPRECATION_WARNINGS
     }
 #endif
 
-    if (report_actual_game_work_duration_ == 0 || update_target_game_work_duration_ == 0 || 
-        report_actual_render_work_duration_ == 0 || update_target_render_work_duration_ == 0 ||
-        report_actual_rhi_work_duration_ == 0 || update_target_rhi_work_duration_ == 0) {
+    if (get_thermal_headroom_ == 0) {
         // The API is not supported in the platform version.
         return false;
     }
+
+    if(FMath::IsNaN(UpdateThermalStatusHeadRoom())) {
+        // If thermal headroom is NaN, this device is not support thermal API.
+        return false;
+    }
+
     return true;
 }
 
-// Indicates the start and end of the performance intensive task.
-// The methods call performance hint API to tell the performance
-// hint to the system.
-void ADPFManager::UpdatePerfHintSession(jlong duration_ns, jlong target_duration_ns, bool update_target_duration,
-        jobject obj_perfhint_session_, jmethodID report_actual_work_duration, jmethodID update_target_work_duration) {
+// Retrieve current thermal headroom using JNI call.
+float ADPFManager::UpdateThermalStatusHeadRoom() {
+    thermal_headroom_ = QueryThermalHeadroom(kThermalHeadroomForecastSeconds);
+    return thermal_headroom_;
+}
+
+// Retrieve the thermal headroom forecast. This is a binder call and can be
+// slow, so only the sampler thread calls it once initialized.
+float ADPFManager::QueryThermalHeadroom(const int32_t forecast_seconds) const {
+#if __ANDROID_API__ >= 31
+    // Use NDK API to retrieve thermal status headroom.
+    return AThermal_getThermalHeadroom(thermal_manager_, forecast_seconds);
+#endif
+
+    if (get_thermal_headroom_ == 0) {
+        return 0.f;
+    }
+
+    float head_room = 0.f;
 #if PLATFORM_ANDROID
-    if (obj_perfhint_session_) {
-        // Report and update the target work duration using JNI calls.
-        if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
-            env->CallVoidMethod(obj_perfhint_session_, report_actual_work_duration,
-                                duration_ns);
-            if(update_target_duration) {
-                env->CallVoidMethod(obj_perfhint_session_, update_target_work_duration,
-                                    target_duration_ns);
-            }
+    // Get thermal headroom!
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        head_room = env->CallFloatMethod(obj_power_service_, get_thermal_headroom_, forecast_seconds);
+    }
+#endif
+    return head_room;
+}
+
+// Called on the sampler thread.
+void ADPFManager::SampleThermalStatus(ADPFThermalSnapshot& snapshot) const {
+    ADPF_SCOPE(ThermalSample);
+    // Forecasts are only needed in predictive mode. One horizon is sampled
+    // per call, the others keep their last value.
+    const bool predictive = CVarAndroidPerformanceChangeQualites.GetValueOnAnyThread() == 3;
+    const int32 forecast = predictive && snapshot.forecast_count > 0 ? snapshot.sample_index % snapshot.forecast_count : 0;
+    const int32 forecast_seconds = forecast == 0 ? kThermalHeadroomForecastSeconds : snapshot.forecast_seconds[forecast];
+    snapshot.sample_index++;
+
+    // NaN means the platform rate limited the call, keep the last headroom.
+    const float head_room = QueryThermalHeadroom(forecast_seconds);
+    if (!FMath::IsNaN(head_room)) {
+        if (forecast == 0) {
+            snapshot.headroom = head_room;
+        }
+        if (snapshot.forecast_count > 0) {
+            snapshot.forecast_headroom[forecast] = head_room;
         }
     }
+#if PLATFORM_ANDROID
+    if (thermal_manager_ != nullptr) {
+        snapshot.status = AThermal_getCurrentThermalStatus(thermal_manager_);
+    }
+#endif
+    SampleSystemHealth(snapshot);
+    SampleMemory(snapshot);
+    snapshot.game_mode = QueryGameMode();
+    snapshot.timestamp_ns = Clock();
+}
+
+// Read the platform's minimum interval between compute headroom calls.
+void ADPFManager::InitializeSystemHealth() {
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    if (!api.IsSystemHealthAvailable()) {
+        return;
+    }
+    int64_t cpu_interval_ms = 0;
+    int64_t gpu_interval_ms = 0;
+    if (api.get_cpu_headroom_min_interval_millis(&cpu_interval_ms) != 0 ||
+            api.get_gpu_headroom_min_interval_millis(&gpu_interval_ms) != 0) {
+        return;
+    }
+    // A positive value marks the API as available.
+    system_health_min_interval_ = FMath::Max<double>(FMath::Max(cpu_interval_ms, gpu_interval_ms) * 0.001, 0.001);
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Compute headroom min interval CPU %lldms GPU %lldms"),
+            static_cast<long long>(cpu_interval_ms), static_cast<long long>(gpu_interval_ms));
+}
+
+// Called on the sampler thread. The calls go through binder like the thermal
+// headroom, and are skipped when the platform's minimum interval hasn't passed.
+void ADPFManager::SampleSystemHealth(ADPFThermalSnapshot& snapshot) const {
+    if (system_health_min_interval_ <= 0.0 || CVarAndroidPerformanceComputeHeadroom.GetValueOnAnyThread() == 0) {
+        return;
+    }
+    const int64 now = Clock();
+    if (now - snapshot.system_health_timestamp_ns < SecondsToNanos(system_health_min_interval_)) {
+        return;
+    }
+    snapshot.system_health_timestamp_ns = now;
+
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    float head_room = 0.f;
+    if (api.get_cpu_headroom(nullptr, &head_room) == 0 && !FMath::IsNaN(head_room)) {
+        snapshot.cpu_headroom = head_room;
+    }
+    if (api.get_gpu_headroom(nullptr, &head_room) == 0 && !FMath::IsNaN(head_room)) {
+        snapshot.gpu_headroom = head_room;
+    }
+}
+
+// Memory under pressure, otherwise the resource with clearly less headroom,
+// if both were sampled.
+EADPFBottleneck ADPFManager::GetBottleneck() const {
+    if (memory_pressure_ > 0) {
+        return EADPFBottleneck::Memory;
+    }
+    if (CVarAndroidPerformanceComputeHeadroom.GetValueOnAnyThread() == 0) {
+        return EADPFBottleneck::None;
+    }
+    const ADPFThermalSnapshot snapshot = thermal_sampler_.GetSnapshot();
+    if (snapshot.cpu_headroom < 0.f || snapshot.gpu_headroom < 0.f) {
+        return EADPFBottleneck::None;
+    }
+    const float margin = CVarAndroidPerformanceBottleneckMargin.GetValueOnAnyThread();
+    if (snapshot.cpu_headroom + margin < snapshot.gpu_headroom) {
+        return EADPFBottleneck::CPU;
+    }
+    if (snapshot.gpu_headroom + margin < snapshot.cpu_headroom) {
+        return EADPFBottleneck::GPU;
+    }
+    return EADPFBottleneck::None;
+}
+
+// Choose the performance hint backend for the running platform version.
+void ADPFManager::SelectPerformanceHintBackend() {
+#if PLATFORM_ANDROID
+    if (android_get_device_api_level() >= 33 && ADPFNativeApi::Get().IsPerformanceHintAvailable()) {
+        perfhint_backend_ = EPerfHintBackend::Native;
+    } else if (android_get_device_api_level() >= 31) {
+        perfhint_backend_ = EPerfHintBackend::Java;
+    } else {
+        perfhint_backend_ = EPerfHintBackend::None;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Performance hint backend:%d"), static_cast<int32>(perfhint_backend_));
 #endif
 }
 
-jlong ADPFManager::fpsToNanosec(const float maxFPS) {
-    return static_cast<jlong>(1000000000.0f / maxFPS);
+// Thread id of a primary thread, or 0 if the thread doesn't exist.
+static uint32 GetPrimaryThreadId(EPerfHintThread thread) {
+PRAGMA_DISABLE_DEPRECATION_WARNINGS
+    switch (thread) {
+        case EPerfHintThread::Game:
+            return GGameThreadId;
+        case EPerfHintThread::Render:
+            return GRenderThreadId;
+        case EPerfHintThread::RHI:
+            return GRHIThreadId;
+        default:
+            return 0;
+    }
+PRAGMA_ENABLE_DEPRECATION_WARNINGS
 }
 
-void ADPFManager::saveQualityLevel(const int32_t warning_level) {
-    if(warning_level >= 0 && warning_level < max_quality_count) {
-        target_quality_level = warning_level;
+// True when a primary thread has a different id than when the sessions were
+// created.
+bool ADPFManager::PrimaryThreadsChanged() const {
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        if (GetPrimaryThreadId(static_cast<EPerfHintThread>(i)) != perfhint_primary_thread_ids_[i]) {
+            return true;
+        }
     }
+    return false;
 }
 
-void ADPFManager::saveQualityLevel(const float head_room) {
-    if(head_room < 0.75f) {
-        // 0.0 < x < 0.75
-        target_quality_level = 3;
+// Collect the thread groups on the game thread, and create their sessions on
+// a worker. The JNI lookups and session creation go through binder and would
+// hitch the frame that does them.
+void ADPFManager::StartPerfHintSessions() {
+    ParseThreadGroups();
+    ParsePowerEfficiencyThreadGroups();
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        perfhint_primary_thread_ids_[i] = GetPrimaryThreadId(static_cast<EPerfHintThread>(i));
     }
-    else if(head_room < 0.85f) {
-        // 0.75 < x < 0.85
-        target_quality_level = 2;
+    gpu_reporting_thread_ = perfhint_primary_groups_[static_cast<int32>(EPerfHintThread::RHI)] != nullptr ?
+            EPerfHintThread::RHI : EPerfHintThread::Render;
+    for (int32 i = 0; i < perfhint_group_count_; ++i) {
+        CollectThreadIds(perfhint_groups_[i], perfhint_groups_[i].thread_ids);
     }
-    else if(head_room < 0.95f) {
-        // 0.85 < x < 0.95
-        target_quality_level = 1;
+
+    if (CVarAndroidPerformanceAsyncSessionInit.GetValueOnGameThread() == 0) {
+        InitializePerformanceHintManager();
+        FinishPerfHintSessions();
+        return;
     }
-    else {
-        // 0.95 < x
-        target_quality_level = 0;
+
+    // Until the task completes the worker owns the sessions, and the game
+    // thread leaves the groups alone.
+    perfhint_init_task_ = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this] {
+        InitializePerformanceHintManager();
+    });
+}
+
+// Game thread, after InitializePerformanceHintManager() returned.
+void ADPFManager::FinishPerfHintSessions() {
+    perfhint_init_task_ = UE::Tasks::FTask();
+    last_thread_scan_clock_ = Clock();
+    perfhint_sessions_ready_.store(true, std::memory_order_release);
+}
+
+// Create the hint sessions of the collected thread groups with the selected
+// backend. Runs on a worker unless r.AndroidPerformanceAsyncSessionInit is 0.
+bool ADPFManager::InitializePerformanceHintManager() {
+    switch (perfhint_backend_) {
+        case EPerfHintBackend::Native:
+            if (!InitializeNativePerformanceHintManager()) {
+                return false;
+            }
+            break;
+        case EPerfHintBackend::Java:
+            if (!InitializeJavaPerformanceHintManager()) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+
+    bool created = false;
+    for (int32 i = 0; i < perfhint_group_count_; ++i) {
+        PerfHintThreadGroup& group = perfhint_groups_[i];
+        if (group.thread_ids.Num() > 0 &&
+                CreatePerfHintSession(group.thread_ids, group.session, group.prefer_power_efficiency)) {
+            created = true;
+        } else {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to create a perf hint session."));
+        }
+    }
+    return created;
+}
+
+// Initialize the performance hint manager using the NDK API.
+bool ADPFManager::InitializeNativePerformanceHintManager() {
+#if PLATFORM_ANDROID
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    perfhint_manager_ = api.get_manager();
+    if (perfhint_manager_ == nullptr) {
+        return false;
+    }
+    preferred_update_rate_ = api.get_preferred_update_rate_nanos(perfhint_manager_);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Initialize JNI calls for the PowerHintManager.
+bool ADPFManager::InitializeJavaPerformanceHintManager() {
+#if PLATFORM_ANDROID
+    // Already looked up before the sessions were last closed.
+    if (obj_perfhint_service_ != nullptr) {
+        return create_hint_session_ != 0;
+    }
+
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        // Retrieve class information
+        jclass context = env->FindClass("android/content/Context");
+
+        // Get the value of a constant
+        jfieldID fid = env->GetStaticFieldID(context, "PERFORMANCE_HINT_SERVICE",
+                                             "Ljava/lang/String;");
+        if(!fid) {
+            // Remove exception
+            if(env->ExceptionCheck()) {
+                env->ExceptionDescribe();
+                env->ExceptionClear();
+            }
+            return false;
+        }
+        jobject str_svc = env->GetStaticObjectField(context, fid);
+
+        // Get the method 'getSystemService' and call it
+        extern struct android_app* GNativeAndroidApp;
+        jmethodID mid_getss = env->GetMethodID(
+                context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+        jobject obj_perfhint_service = env->CallObjectMethod(
+                GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+
+        // Add global reference to the power service object.
+        obj_perfhint_service_ = env->NewGlobalRef(obj_perfhint_service);
+
+        // Retrieve methods IDs for the APIs.
+        jclass cls_perfhint_service = env->GetObjectClass(obj_perfhint_service_);
+        create_hint_session_ =
+                env->GetMethodID(cls_perfhint_service, "createHintSession",
+                                 "([IJ)Landroid/os/PerformanceHintManager$Session;");
+        jmethodID mid_preferedupdaterate = env->GetMethodID(
+                cls_perfhint_service, "getPreferredUpdateRateNanos", "()J");
+        if (mid_preferedupdaterate) {
+            preferred_update_rate_ = env->CallLongMethod(obj_perfhint_service_, mid_preferedupdaterate);
+        }
+
+        // Free local references
+        env->DeleteLocalRef(cls_perfhint_service);
+        env->DeleteLocalRef(obj_perfhint_service);
+        env->DeleteLocalRef(str_svc);
+        env->DeleteLocalRef(context);
+
+        // Remove exception
+        if(env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+#endif
+
+    if (create_hint_session_ == 0) {
+        // The API is not supported in the platform version.
+        return false;
+    }
+    return true;
+}
+
+// Create a hint session over the threads with the selected backend.
+bool ADPFManager::CreatePerfHintSession(const TArray<int32>& thread_ids, PerfHintSession& session,
+        bool prefer_power_efficiency) {
+#if PLATFORM_ANDROID
+    ADPF_SCOPE(CreateSession);
+    const jlong DEFAULT_TARGET_NS = 16666666;
+
+    if (perfhint_backend_ == EPerfHintBackend::Native) {
+        const ADPFNativeApi& api = ADPFNativeApi::Get();
+        session.native_session = api.create_session(perfhint_manager_,
+                thread_ids.GetData(), thread_ids.Num(), DEFAULT_TARGET_NS);
+        if (session.native_session != nullptr && api.IsWorkDurationAvailable()) {
+            session.work_duration = api.work_duration_create();
+        }
+        if (session.native_session != nullptr && prefer_power_efficiency && api.set_prefer_power_efficiency != nullptr) {
+            api.set_prefer_power_efficiency(session.native_session, true);
+        }
+        return session.native_session != nullptr;
+    }
+
+    if (perfhint_backend_ != EPerfHintBackend::Java || obj_perfhint_service_ == nullptr) {
+        return false;
+    }
+
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        jintArray array = env->NewIntArray(thread_ids.Num());
+        env->SetIntArrayRegion(array, 0, thread_ids.Num(), thread_ids.GetData());
+
+        jobject obj_hintsession = env->CallObjectMethod(obj_perfhint_service_, create_hint_session_, array, DEFAULT_TARGET_NS);
+        if (obj_hintsession) {
+            session.obj_session = env->NewGlobalRef(obj_hintsession);
+
+            jclass cls_perfhint_session = env->GetObjectClass(obj_hintsession);
+            session.report_actual_work_duration = env->GetMethodID(cls_perfhint_session, "reportActualWorkDuration", "(J)V");
+            session.update_target_work_duration = env->GetMethodID(cls_perfhint_session, "updateTargetWorkDuration", "(J)V");
+            session.close = env->GetMethodID(cls_perfhint_session, "close", "()V");
+            // Session.setThreads() is only available from API 34.
+            if (android_get_device_api_level() >= 34) {
+                session.set_threads = env->GetMethodID(cls_perfhint_session, "setThreads", "([I)V");
+            }
+            env->DeleteLocalRef(cls_perfhint_session);
+        }
+
+        env->DeleteLocalRef(obj_hintsession);
+        env->DeleteLocalRef(array);
+
+        // Remove exception
+        if(env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+    return session.report_actual_work_duration != 0 && session.update_target_work_duration != 0;
+#else
+    return false;
+#endif
+}
+
+// Replace the threads of a session. Sessions on platforms without
+// setThreads() are recreated with the new threads.
+void ADPFManager::SetPerfHintSessionThreads(const TArray<int32>& thread_ids, PerfHintSession& session,
+        bool prefer_power_efficiency) {
+#if PLATFORM_ANDROID
+    ADPF_SCOPE(SetThreads);
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    if (session.native_session != nullptr && api.set_threads != nullptr) {
+        if (api.set_threads(session.native_session, thread_ids.GetData(), thread_ids.Num()) == 0) {
+            return;
+        }
+    } else if (session.obj_session != nullptr && session.set_threads != 0) {
+        if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+            jintArray array = env->NewIntArray(thread_ids.Num());
+            env->SetIntArrayRegion(array, 0, thread_ids.Num(), thread_ids.GetData());
+            env->CallVoidMethod(session.obj_session, session.set_threads, array);
+            env->DeleteLocalRef(array);
+            if (!env->ExceptionCheck()) {
+                return;
+            }
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+
+    ReleasePerfHintSession(session);
+    if (thread_ids.Num() > 0) {
+        CreatePerfHintSession(thread_ids, session, prefer_power_efficiency);
+    }
+#endif
+}
+
+// Indicates the start and end of the performance intensive task.
+// The methods call performance hint API to tell the performance
+// hint to the system.
+void ADPFManager::UpdatePerfHintSession(jlong duration_ns, jlong target_duration_ns, bool update_target_duration,
+        const PerfHintSession& session, int64 start_timestamp_ns, int64 gpu_duration_ns) {
+#if PLATFORM_ANDROID
+    if (session.native_session) {
+        // Report and update the target work duration using the NDK API.
+        const ADPFNativeApi& api = ADPFNativeApi::Get();
+        if (session.work_duration != nullptr && start_timestamp_ns > 0) {
+            // Split CPU and GPU work, API 35. The GPU works on an earlier
+            // frame in parallel, so the frame takes the longer of the two.
+            api.work_duration_set_work_period_start_timestamp_nanos(session.work_duration, start_timestamp_ns);
+            api.work_duration_set_actual_total_duration_nanos(session.work_duration, FMath::Max(duration_ns, gpu_duration_ns));
+            api.work_duration_set_actual_cpu_duration_nanos(session.work_duration, duration_ns);
+            api.work_duration_set_actual_gpu_duration_nanos(session.work_duration, gpu_duration_ns);
+            api.report_actual_work_duration2(session.native_session, session.work_duration);
+        } else {
+            api.report_actual_work_duration(session.native_session, duration_ns);
+        }
+        if(update_target_duration) {
+            api.update_target_work_duration(session.native_session, target_duration_ns);
+        }
+    } else if (session.obj_session) {
+        // Report and update the target work duration using JNI calls.
+        if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+            env->CallVoidMethod(session.obj_session, session.report_actual_work_duration,
+                                duration_ns);
+            if(update_target_duration) {
+                env->CallVoidMethod(session.obj_session, session.update_target_work_duration,
+                                    target_duration_ns);
+            }
+        }
+    }
+#endif
+}
+
+// Close the session and release its global reference.
+void ADPFManager::ReleasePerfHintSession(PerfHintSession& session) {
+#if PLATFORM_ANDROID
+    ADPF_SCOPE(CloseSession);
+    if (session.work_duration != nullptr) {
+        ADPFNativeApi::Get().work_duration_release(session.work_duration);
+    }
+    if (session.native_session != nullptr) {
+        ADPFNativeApi::Get().close_session(session.native_session);
+    }
+    if (session.obj_session != nullptr) {
+        if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+            if (session.close != 0) {
+                env->CallVoidMethod(session.obj_session, session.close);
+                if (env->ExceptionCheck()) {
+                    env->ExceptionDescribe();
+                    env->ExceptionClear();
+                }
+            }
+            env->DeleteGlobalRef(session.obj_session);
+        }
+    }
+#endif
+    session = PerfHintSession();
+}
+
+static bool ParsePrimaryThread(const FString& token, EPerfHintThread& out_thread) {
+    if (token.Equals(TEXT("Game"), ESearchCase::IgnoreCase)) {
+        out_thread = EPerfHintThread::Game;
+    } else if (token.Equals(TEXT("Render"), ESearchCase::IgnoreCase)) {
+        out_thread = EPerfHintThread::Render;
+    } else if (token.Equals(TEXT("RHI"), ESearchCase::IgnoreCase)) {
+        out_thread = EPerfHintThread::RHI;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Build the thread groups from r.AndroidPerformanceThreadGroups. A primary
+// thread listed inside an earlier group doesn't get a group of its own, and
+// its frame hook doesn't report.
+void ADPFManager::ParseThreadGroups() {
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        perfhint_primary_groups_[i] = nullptr;
+    }
+    perfhint_group_count_ = 0;
+
+    bool claimed[static_cast<int32>(EPerfHintThread::Count)] = {};
+    TArray<FString> groups;
+    CVarAndroidPerformanceThreadGroups.GetValueOnGameThread().ParseIntoArray(groups, TEXT(";"));
+    for (const FString& group_string : groups) {
+        TArray<FString> tokens;
+        group_string.ParseIntoArray(tokens, TEXT(","));
+        for (FString& token : tokens) {
+            token.TrimStartAndEndInline();
+        }
+
+        EPerfHintThread primary;
+        if (tokens.Num() == 0 || !ParsePrimaryThread(tokens[0], primary)) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Thread group '%s' must start with Game, Render or RHI."), *group_string);
+            continue;
+        }
+        if (claimed[static_cast<int32>(primary)] || GetPrimaryThreadId(primary) == 0) {
+            continue;
+        }
+        if (perfhint_group_count_ == kMaxPerfHintGroups) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Too many thread groups, ignoring '%s'."), *group_string);
+            break;
+        }
+
+        PerfHintThreadGroup& group = perfhint_groups_[perfhint_group_count_++];
+        group.has_primary = true;
+        group.prefer_power_efficiency = game_mode_profile_.prefer_power_efficiency;
+        group.primary = primary;
+        group.member_threads.Reset();
+        group.member_name_prefixes.Reset();
+        claimed[static_cast<int32>(primary)] = true;
+        perfhint_primary_groups_[static_cast<int32>(primary)] = &group;
+
+        for (int32 i = 1; i < tokens.Num(); ++i) {
+            EPerfHintThread member;
+            if (ParsePrimaryThread(tokens[i], member)) {
+                if (!claimed[static_cast<int32>(member)]) {
+                    claimed[static_cast<int32>(member)] = true;
+                    group.member_threads.Add(member);
+                }
+            } else if (!tokens[i].IsEmpty()) {
+                group.member_name_prefixes.Add(tokens[i]);
+            }
+        }
+    }
+}
+
+// Add the groups of r.AndroidPerformancePowerEfficiencyThreadGroups after the
+// primary thread groups. setPreferPowerEfficiency() is only in the NDK API.
+void ADPFManager::ParsePowerEfficiencyThreadGroups() {
+    if (CVarAndroidPerformancePowerEfficiency.GetValueOnGameThread() == 0 ||
+            perfhint_backend_ != EPerfHintBackend::Native ||
+            ADPFNativeApi::Get().set_prefer_power_efficiency == nullptr) {
+        return;
+    }
+
+    TArray<FString> groups;
+    CVarAndroidPerformancePowerEfficiencyThreadGroups.GetValueOnGameThread().ParseIntoArray(groups, TEXT(";"));
+    for (const FString& group_string : groups) {
+        TArray<FString> tokens;
+        group_string.ParseIntoArray(tokens, TEXT(","));
+        for (FString& token : tokens) {
+            token.TrimStartAndEndInline();
+        }
+        tokens.RemoveAll([](const FString& token) { return token.IsEmpty(); });
+        if (tokens.Num() == 0) {
+            continue;
+        }
+        if (perfhint_group_count_ == kMaxPerfHintGroups) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Too many thread groups, ignoring '%s'."), *group_string);
+            break;
+        }
+
+        PerfHintThreadGroup& group = perfhint_groups_[perfhint_group_count_++];
+        group.has_primary = false;
+        group.prefer_power_efficiency = true;
+        group.member_threads.Reset();
+        group.member_name_prefixes = MoveTemp(tokens);
+    }
+}
+
+// Collect the sorted thread ids of a group.
+void ADPFManager::CollectThreadIds(const PerfHintThreadGroup& group, TArray<int32>& out_thread_ids) const {
+    out_thread_ids.Reset();
+    if (group.has_primary) {
+        out_thread_ids.Add(static_cast<int32>(GetPrimaryThreadId(group.primary)));
+    }
+    for (EPerfHintThread member : group.member_threads) {
+        if (const uint32 thread_id = GetPrimaryThreadId(member)) {
+            out_thread_ids.AddUnique(static_cast<int32>(thread_id));
+        }
+    }
+
+    if (group.member_name_prefixes.Num() > 0) {
+        FThreadManager::Get().ForEachThread([&](uint32 thread_id, FRunnableThread* thread) {
+            const FString& name = thread->GetThreadName();
+            for (const FString& prefix : group.member_name_prefixes) {
+                if (name.StartsWith(prefix)) {
+                    out_thread_ids.AddUnique(static_cast<int32>(thread_id));
+                    break;
+                }
+            }
+        });
+    }
+    out_thread_ids.Sort();
+}
+
+// Threads can be created or renamed at any time, so the groups are rescanned
+// periodically. The new thread list is applied by the thread that owns the
+// session on its next report, or right away for power efficiency groups.
+void ADPFManager::RescanThreadGroups() {
+    TArray<int32> thread_ids;
+    for (int32 i = 0; i < perfhint_group_count_; ++i) {
+        PerfHintThreadGroup& group = perfhint_groups_[i];
+        CollectThreadIds(group, thread_ids);
+        if (thread_ids != group.thread_ids) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Thread group %d changed to %d threads"), i, thread_ids.Num());
+            group.thread_ids = thread_ids;
+
+            if (!group.has_primary) {
+                SetPerfHintSessionThreads(thread_ids, group.session, group.prefer_power_efficiency);
+                continue;
+            }
+
+            FScopeLock lock(&group.pending_lock);
+            group.pending_thread_ids = thread_ids;
+            group.has_pending_thread_ids.store(true, std::memory_order_release);
+        }
+    }
+}
+
+// Name of the resource a lowering steps first, for the log.
+static const TCHAR* GetBottleneckName(EADPFBottleneck bottleneck) {
+    switch (bottleneck) {
+        case EADPFBottleneck::CPU:
+            return TEXT("CPU");
+        case EADPFBottleneck::GPU:
+            return TEXT("GPU");
+        case EADPFBottleneck::Memory:
+            return TEXT("memory");
+        default:
+            return TEXT("none");
+    }
+}
+
+int32 ADPFManager::GetQualityCap() const {
+    // The game mode caps the quality only while the plugin adjusts it.
+    if (CVarAndroidPerformanceChangeQualites.GetValueOnGameThread() == 0) {
+        return memory_quality_cap_;
+    }
+    return FMath::Min(game_mode_profile_.max_quality_level, memory_quality_cap_);
+}
+
+void ADPFManager::ApplyQualityLevel(int32_t new_target) {
+    // The game mode and the memory pressure can cap the quality level.
+    new_target = FMath::Min(new_target, GetQualityCap());
+    if(current_quality_level != new_target) {
+        if(new_target >= max_quality_count) {
+            new_target = max_quality_count - 1;
+        }
+        const bool lowering = new_target < current_quality_level;
+        current_quality_level = new_target;
+
+        // Change Unreal scalability quality. The ladder changes one group per
+        // step, spread over frames, to avoid a single long hitch.
+        // https://docs.unrealengine.com/4.27/en-US/TestingAndOptimization/PerformanceAndProfiling/Scalability/ScalabilityReference/
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Change quality level to %d"), new_target);
+        ADPF_RECORD_EVENT(TEXT("ADPF quality level %d"), new_target);
+        const EADPFBottleneck bottleneck = lowering ? GetBottleneck() : EADPFBottleneck::None;
+        if (bottleneck != EADPFBottleneck::None) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Lowering the %s groups first"), GetBottleneckName(bottleneck));
+        }
+        quality_ladder_.SetTarget(quality_levels[new_target], lowering, bottleneck);
+        quality_governor_.OnLevelApplied(NanosToSeconds(monitor_clock_));
+        quality_change_count_++;
+    }
+}
+
+// Read the forecast horizons. Called before the sampler thread starts.
+void ADPFManager::ParseThermalForecastHorizons(ADPFThermalSnapshot& snapshot) const {
+    snapshot.forecast_count = 1;
+    snapshot.forecast_seconds[0] = 0;
+    snapshot.forecast_headroom[0] = snapshot.headroom;
+
+    for (int32 i = 0; i < ListAndroidPerformanceThermalForecastHorizons.Num(); ++i) {
+        const int32 seconds = FMath::Min(ListAndroidPerformanceThermalForecastHorizons.Get(i, 0), kMaxThermalForecastSeconds);
+        if (seconds <= 0) {
+            continue;
+        }
+        if (snapshot.forecast_count == kMaxThermalForecasts) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Only %d thermal forecast horizons are sampled."), kMaxThermalForecasts);
+            break;
+        }
+        snapshot.forecast_seconds[snapshot.forecast_count] = seconds;
+        snapshot.forecast_headroom[snapshot.forecast_count] = snapshot.headroom;
+        snapshot.forecast_count++;
+    }
+}
+
+// Least squares fit of the forecasts over their horizons, extrapolated to the
+// lookahead. The prediction never falls below the current headroom, so a
+// falling trend doesn't raise quality before the device has cooled down.
+float ADPFManager::PredictThermalHeadroom(const ADPFThermalSnapshot& snapshot) const {
+    if (snapshot.forecast_count < 2) {
+        return snapshot.headroom;
+    }
+
+    float mean_x = 0.f;
+    float mean_y = 0.f;
+    for (int32 i = 0; i < snapshot.forecast_count; ++i) {
+        mean_x += snapshot.forecast_seconds[i];
+        mean_y += snapshot.forecast_headroom[i];
+    }
+    mean_x /= snapshot.forecast_count;
+    mean_y /= snapshot.forecast_count;
+
+    float covariance = 0.f;
+    float variance = 0.f;
+    for (int32 i = 0; i < snapshot.forecast_count; ++i) {
+        const float dx = snapshot.forecast_seconds[i] - mean_x;
+        covariance += dx * (snapshot.forecast_headroom[i] - mean_y);
+        variance += dx * dx;
+    }
+    if (variance <= 0.f) {
+        return snapshot.headroom;
+    }
+
+    // Headroom change per second.
+    const float slope = covariance / variance;
+    const float lookahead = CVarAndroidPerformancePredictiveLookahead.GetValueOnAnyThread();
+    const float predicted = mean_y + slope * (lookahead - mean_x);
+    return FMath::Max(predicted, snapshot.headroom);
+}
+
+// Feed each new headroom sample to the model, at the level the ladder has
+// settled on. A replay doesn't teach the model of this device.
+void ADPFManager::LearnThermalModel() {
+    if (CVarAndroidPerformanceThermalModel.GetValueOnGameThread() == 0 || thermal_trace_reader_.IsOpen()) {
+        return;
+    }
+    const ADPFThermalSnapshot thermal_snapshot = thermal_sampler_.GetSnapshot();
+    if (thermal_snapshot.timestamp_ns <= 0 || thermal_snapshot.timestamp_ns == last_model_sample_timestamp_ns_) {
+        return;
+    }
+    last_model_sample_timestamp_ns_ = thermal_snapshot.timestamp_ns;
+    thermal_model_.AddSample(quality_ladder_.IsSettled() ? current_quality_level : -1,
+            thermal_snapshot.headroom, NanosToSeconds(thermal_snapshot.timestamp_ns));
+}
+
+void ADPFManager::SaveThermalModel() const {
+    if (CVarAndroidPerformanceThermalModel.GetValueOnGameThread() != 0 && thermal_model_loaded_) {
+        thermal_model_.Save(GetThermalModelPath());
+    }
+}
+
+// Seconds left of the expected session. It starts with the first governor
+// update unless SetExpectedSessionLength() was called.
+float ADPFManager::GetRemainingSessionSeconds() {
+    if (plan_end_clock_ < 0) {
+        plan_end_clock_ = monitor_clock_ + SecondsToNanos(FMath::Max(CVarAndroidPerformancePlanHorizon.GetValueOnGameThread(), 0.0f));
+    }
+    return static_cast<float>(NanosToSeconds(FMath::Max<int64>(plan_end_clock_ - monitor_clock_, 0)));
+}
+
+void ADPFManager::SetExpectedSessionLength(float seconds) {
+    plan_end_clock_ = monitor_clock_ + SecondsToNanos(FMath::Max(seconds, 0.0f));
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Planning for a session of %.0fs"), seconds);
+}
+
+void ADPFManager::DumpThermalModel() const {
+    const float horizon = plan_end_clock_ < 0 ? CVarAndroidPerformancePlanHorizon.GetValueOnGameThread() :
+            FMath::Max(static_cast<float>(NanosToSeconds(plan_end_clock_ - monitor_clock_)), kMinPlanHorizonSeconds);
+    for (int32 level = 0; level < max_quality_count; ++level) {
+        ADPFThermalModelFit fit;
+        if (!thermal_model_.GetFit(level, fit)) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal model level %d: no observations"), level);
+            continue;
+        }
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal model level %d: %u observations, rate %.5f/s, equilibrium %.3f, time constant %.0fs, peak %.3f in %.0fs%s"),
+                level, fit.observation_count, fit.mean_rate, fit.has_time_constant ? fit.equilibrium : -1.0f,
+                fit.has_time_constant ? fit.time_constant : -1.0f,
+                thermal_model_.PredictPeakHeadroom(level, thermal_headroom_, horizon), horizon,
+                thermal_model_.CanPredict(level) ? TEXT("") : TEXT(" (learning)"));
+    }
+}
+
+void ADPFManager::ResetThermalModel() {
+    thermal_model_.Reset();
+    SaveThermalModel();
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal model reset"));
+}
+
+void ADPFManager::RegisterPolicy(FName name, TSharedRef<IAndroidPerformancePolicy> policy) {
+    registered_policies_.Add(name, policy);
+    policy_selection_dirty_ = true;
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Registered the policy %s"), *name.ToString());
+}
+
+void ADPFManager::UnregisterPolicy(FName name) {
+    if (registered_policies_.Remove(name) > 0) {
+        policy_selection_dirty_ = true;
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Unregistered the policy %s"), *name.ToString());
+    }
+}
+
+// Drop every registered policy, so none outlives the module that
+// implements it.
+void ADPFManager::UnregisterAllPolicies() {
+    registered_policies_.Reset();
+    custom_policy_.Reset();
+    policy_selection_dirty_ = true;
+}
+
+// Look up the policy r.AndroidPerformancePolicy names, after it or the
+// registered policies changed.
+void ADPFManager::SelectCustomPolicy() {
+    policy_selection_dirty_ = false;
+    const FName name(*CVarAndroidPerformancePolicy.GetValueOnGameThread());
+    const TSharedRef<IAndroidPerformancePolicy>* policy = name.IsNone() ? nullptr : registered_policies_.Find(name);
+    if (!name.IsNone() && policy == nullptr) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("No policy %s is registered, using the built-in policy."), *name.ToString());
+    }
+
+    TSharedPtr<IAndroidPerformancePolicy> selected = policy != nullptr ? TSharedPtr<IAndroidPerformancePolicy>(*policy) : nullptr;
+    if (selected == custom_policy_) {
+        return;
+    }
+    custom_policy_ = selected;
+    if (custom_policy_.IsValid()) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Using the policy %s"), *name.ToString());
+        custom_policy_->Reset();
+    } else {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Using the built-in policy"));
+    }
+}
+
+// A registered policy if one is selected, otherwise the built-in policy of
+// r.AndroidPerformanceChangeQualities, called by its concrete type.
+void ADPFManager::EvaluatePolicy(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision) {
+    if (policy_selection_dirty_) {
+        SelectCustomPolicy();
+    }
+    if (custom_policy_.IsValid()) {
+        custom_policy_->Decide(input, decision);
+        return;
+    }
+
+    const int32 mode = CVarAndroidPerformanceChangeQualites.GetValueOnGameThread();
+    switch (mode) {
+        case 0:
+            break;
+        case 1:
+            threshold_policy_.Decide(input, decision);
+            break;
+        case 2:
+            listener_policy_.Decide(input, decision);
+            break;
+        case 3:
+            predictive_policy_.Decide(input, decision);
+            break;
+        case 4:
+            planned_policy_.Decide(input, decision);
+            break;
+        default:
+            // Unknown modes above 4 keep following the thermal listener, as
+            // before the policies were split out.
+            if (mode > 4) {
+                listener_policy_.Decide(input, decision);
+            }
+            break;
+    }
+}
+
+void ADPFManager::ApplyPolicyDecision(const FAndroidPerformancePolicyDecision& decision, bool severe_throttling) {
+    // The FPS cap follows on the next UpdateFrameRateCap(), the screen
+    // percentage on the next resolution controller tick.
+    policy_frame_rate_cap_ = decision.FrameRateCap;
+    policy_screen_percentage_ = decision.ScreenPercentage > 0.0f ?
+            ADPFResolutionController::ClampScreenPercentage(decision.ScreenPercentage) : 0.0f;
+
+    const float target_scale = decision.TargetWorkScale > 0.0f ? FMath::Clamp(decision.TargetWorkScale, 0.1f, 2.0f) : 0.0f;
+    if (target_scale != policy_target_scale_) {
+        policy_target_scale_ = target_scale;
+        ApplyTargetWorkDuration();
+    }
+
+    if (decision.QualityLevel != INDEX_NONE) {
+        target_quality_level = FMath::Clamp(decision.QualityLevel, 0, max_quality_count - 1);
+        ApplyQualityLevel(quality_governor_.Update(current_quality_level, target_quality_level,
+                NanosToSeconds(monitor_clock_), severe_throttling));
+    }
+}
+
+void ADPFManager::ResetPolicyOverrides() {
+    workload_boost_end_clock_ = 0;
+    policy_frame_rate_cap_ = INDEX_NONE;
+    policy_screen_percentage_ = 0.0f;
+    policy_target_scale_ = 0.0f;
+    if (custom_policy_.IsValid()) {
+        custom_policy_->Reset();
+    }
+}
+
+// Max FPS for the current thermal status, 0 for the game's own max FPS.
+int32 ADPFManager::GetFrameRateCapForThermalStatus() const {
+    if (CVarAndroidPerformanceFrameRateCapEnabled.GetValueOnGameThread() == 0) {
+        return 0;
+    }
+
+    const int32 count = ListAndroidPerformanceFrameRateCaps.Num();
+    if (count == 0) {
+        return 0;
+    }
+    const int32 index = FMath::Clamp(thermal_status_, 0, count - 1);
+    return FMath::Max(ListAndroidPerformanceFrameRateCaps.Get(index, 0), 0);
+}
+
+// Lower the max FPS as the thermal status rises. The display refresh rate
+// and the hint session target follow in the same step.
+void ADPFManager::UpdateFrameRateCap() {
+#if PLATFORM_ANDROID
+    int32 cap = policy_frame_rate_cap_ != INDEX_NONE ? FMath::Max(policy_frame_rate_cap_, 0) :
+            GetFrameRateCapForThermalStatus();
+    const int32 game_mode_cap = game_mode_profile_.frame_rate_cap;
+    if (game_mode_cap > 0 && (cap == 0 || game_mode_cap < cap)) {
+        cap = game_mode_cap;
+    }
+    // Follow the game's own max FPS while no cap is applied, so that a cap
+    // restores the last one the game set.
+    if (frame_rate_cap_ == 0) {
+        game_max_fps_ = GEngine->GetMaxFPS();
+    }
+    if (cap == frame_rate_cap_) {
+        return;
+    }
+    frame_rate_cap_ = cap;
+
+    float max_fps = game_max_fps_;
+    if (cap > 0 && (game_max_fps_ <= 0.0f || cap < game_max_fps_)) {
+        max_fps = static_cast<float>(cap);
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Change max FPS to %.1f for thermal status %d game mode %d"), max_fps,
+            thermal_status_, game_mode_);
+    ADPF_RECORD_EVENT(TEXT("ADPF max FPS %.0f"), max_fps);
+    GEngine->SetMaxFPS(max_fps);
+
+    // Let the panel drop its refresh rate too. 0 removes the preference.
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    extern struct android_app* GNativeAndroidApp;
+    if (api.native_window_set_frame_rate != nullptr && GNativeAndroidApp != nullptr && GNativeAndroidApp->window != nullptr) {
+        // ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT
+        const int8_t compatibility = 0;
+        api.native_window_set_frame_rate(GNativeAndroidApp->window, max_fps, compatibility);
+    }
+
+    // Update the hint session target duration now instead of on the next
+    // max FPS check.
+    SetTargetWorkDuration(max_fps);
+#endif
+}
+
+// Look up GameManager and GameState through JNI.
+void ADPFManager::InitializeGameManager() {
+#if PLATFORM_ANDROID
+    if (android_get_device_api_level() < 31) {
+        return;
+    }
+
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        jclass context = env->FindClass("android/content/Context");
+        jfieldID fid = env->GetStaticFieldID(context, "GAME_SERVICE", "Ljava/lang/String;");
+        if (fid) {
+            jobject str_svc = env->GetStaticObjectField(context, fid);
+
+            extern struct android_app* GNativeAndroidApp;
+            jmethodID mid_getss = env->GetMethodID(
+                    context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+            jobject obj_game_manager = env->CallObjectMethod(
+                    GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+            if (obj_game_manager) {
+                obj_game_manager_ = env->NewGlobalRef(obj_game_manager);
+
+                jclass cls_game_manager = env->GetObjectClass(obj_game_manager_);
+                get_game_mode_ = env->GetMethodID(cls_game_manager, "getGameMode", "()I");
+                // GameState is only available from API 33.
+                if (android_get_device_api_level() >= 33) {
+                    set_game_state_ = env->GetMethodID(cls_game_manager, "setGameState", "(Landroid/app/GameState;)V");
+                    jclass cls_game_state = env->FindClass("android/app/GameState");
+                    if (cls_game_state) {
+                        cls_game_state_ = env->NewGlobalRef(cls_game_state);
+                        game_state_ctor_ = env->GetMethodID(cls_game_state, "<init>", "(ZI)V");
+                        env->DeleteLocalRef(cls_game_state);
+                    }
+                }
+                env->DeleteLocalRef(cls_game_manager);
+            }
+
+            env->DeleteLocalRef(obj_game_manager);
+            env->DeleteLocalRef(str_svc);
+        }
+        env->DeleteLocalRef(context);
+
+        // Remove exception
+        if(env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+#endif
+}
+
+// Called on the sampler thread, and on the game thread before it starts.
+int32 ADPFManager::QueryGameMode() const {
+    int32 game_mode = 0;
+#if PLATFORM_ANDROID
+    if (obj_game_manager_ != nullptr && get_game_mode_ != 0) {
+        if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+            game_mode = env->CallIntMethod(obj_game_manager_, get_game_mode_);
+            if (env->ExceptionCheck()) {
+                env->ExceptionClear();
+                game_mode = 0;
+            }
+        }
+    }
+#endif
+    return game_mode;
+}
+
+// Choose the governor profile of a game mode: 0 unsupported, 1 standard,
+// 2 performance, 3 battery, 4 custom.
+void ADPFManager::ApplyGameMode(int32 game_mode) {
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Game mode %d -> %d"), game_mode_, game_mode);
+    ADPF_RECORD_EVENT(TEXT("ADPF game mode %d"), game_mode);
+    game_mode_ = game_mode;
+
+    ADPFGameModeProfile profile;
+    profile.max_quality_level = FMath::Clamp(ListAndroidPerformanceGameModeQualityCaps.Get(game_mode, max_quality_count - 1),
+            0, max_quality_count - 1);
+    profile.frame_rate_cap = FMath::Max(ListAndroidPerformanceGameModeFrameRateCaps.Get(game_mode, 0), 0);
+    profile.prefer_power_efficiency = ListAndroidPerformanceGameModePowerEfficiency.Get(game_mode, 0) != 0;
+
+    const bool power_efficiency_changed = profile.prefer_power_efficiency != game_mode_profile_.prefer_power_efficiency;
+    game_mode_profile_ = profile;
+
+    // Drop below a lowered cap now. The governor raises the level again
+    // as usual when the cap goes up.
+    if (current_quality_level > GetQualityCap()) {
+        ApplyQualityLevel(GetQualityCap());
+    }
+
+    // The primary threads own their sessions, they apply it on their next
+    // report. The frame rate cap follows on the next UpdateFrameRateCap().
+    if (power_efficiency_changed && !IsReplayingThermalTrace()) {
+        for (int32 i = 0; i < perfhint_group_count_; ++i) {
+            PerfHintThreadGroup& group = perfhint_groups_[i];
+            if (group.has_primary) {
+                group.pending_power_efficiency.store(profile.prefer_power_efficiency ? 1 : 0, std::memory_order_release);
+            }
+        }
+    }
+}
+
+// Tell the system whether the game is loading or playing, API 33.
+void ADPFManager::ReportGameState(bool loading) {
+#if PLATFORM_ANDROID
+    ADPF_SCOPE(GameState);
+    if (CVarAndroidPerformanceGameMode.GetValueOnGameThread() == 0 || obj_game_manager_ == nullptr ||
+            set_game_state_ == 0 || game_state_ctor_ == 0) {
+        return;
+    }
+
+    // GameState.MODE_NONE while loading, MODE_GAMEPLAY_INTERRUPTIBLE after.
+    const jint mode = loading ? 1 : 2;
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        jobject obj_game_state = env->NewObject(static_cast<jclass>(cls_game_state_), game_state_ctor_,
+                static_cast<jboolean>(loading), mode);
+        if (obj_game_state) {
+            env->CallVoidMethod(obj_game_manager_, set_game_state_, obj_game_state);
+            env->DeleteLocalRef(obj_game_state);
+        }
+
+        // Remove exception
+        if(env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+    }
+#endif
+}
+
+// Look up ActivityManager and the memory info objects through JNI. The
+// onTrimMemory() level is read back with getMyMemoryState(), which needs no
+// callback in the activity.
+void ADPFManager::InitializeMemoryMonitor() {
+#if PLATFORM_ANDROID
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        jclass context = env->FindClass("android/content/Context");
+        jfieldID fid = env->GetStaticFieldID(context, "ACTIVITY_SERVICE", "Ljava/lang/String;");
+        if (fid) {
+            jobject str_svc = env->GetStaticObjectField(context, fid);
+
+            extern struct android_app* GNativeAndroidApp;
+            jmethodID mid_getss = env->GetMethodID(
+                    context, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+            jobject obj_activity_manager = env->CallObjectMethod(
+                    GNativeAndroidApp->activity->clazz, mid_getss, str_svc);
+            jclass cls_activity_manager = env->FindClass("android/app/ActivityManager");
+            jclass cls_memory_info = env->FindClass("android/app/ActivityManager$MemoryInfo");
+            if (obj_activity_manager && cls_activity_manager && cls_memory_info) {
+                get_memory_info_ = env->GetMethodID(cls_activity_manager, "getMemoryInfo",
+                        "(Landroid/app/ActivityManager$MemoryInfo;)V");
+                avail_mem_field_ = env->GetFieldID(cls_memory_info, "availMem", "J");
+                total_mem_field_ = env->GetFieldID(cls_memory_info, "totalMem", "J");
+                threshold_field_ = env->GetFieldID(cls_memory_info, "threshold", "J");
+                low_memory_field_ = env->GetFieldID(cls_memory_info, "lowMemory", "Z");
+                jmethodID memory_info_ctor = env->GetMethodID(cls_memory_info, "<init>", "()V");
+                jobject obj_memory_info = memory_info_ctor ? env->NewObject(cls_memory_info, memory_info_ctor) : nullptr;
+                if (get_memory_info_ && avail_mem_field_ && total_mem_field_ && threshold_field_ &&
+                        low_memory_field_ && obj_memory_info) {
+                    obj_activity_manager_ = env->NewGlobalRef(obj_activity_manager);
+                    obj_memory_info_ = env->NewGlobalRef(obj_memory_info);
+                }
+                if (obj_memory_info) {
+                    env->DeleteLocalRef(obj_memory_info);
+                }
+
+                // The trim level is optional, the available memory is enough
+                // on its own.
+                get_my_memory_state_ = env->GetStaticMethodID(cls_activity_manager, "getMyMemoryState",
+                        "(Landroid/app/ActivityManager$RunningAppProcessInfo;)V");
+                jclass cls_process_info = env->FindClass("android/app/ActivityManager$RunningAppProcessInfo");
+                if (obj_memory_info_ && get_my_memory_state_ && cls_process_info) {
+                    last_trim_level_field_ = env->GetFieldID(cls_process_info, "lastTrimLevel", "I");
+                    jmethodID process_info_ctor = env->GetMethodID(cls_process_info, "<init>", "()V");
+                    jobject obj_process_info = process_info_ctor ? env->NewObject(cls_process_info, process_info_ctor) : nullptr;
+                    if (last_trim_level_field_ && obj_process_info) {
+                        cls_activity_manager_ = env->NewGlobalRef(cls_activity_manager);
+                        obj_process_info_ = env->NewGlobalRef(obj_process_info);
+                    }
+                    if (obj_process_info) {
+                        env->DeleteLocalRef(obj_process_info);
+                    }
+                }
+                if (cls_process_info) {
+                    env->DeleteLocalRef(cls_process_info);
+                }
+            }
+
+            if (cls_memory_info) {
+                env->DeleteLocalRef(cls_memory_info);
+            }
+            if (cls_activity_manager) {
+                env->DeleteLocalRef(cls_activity_manager);
+            }
+            if (obj_activity_manager) {
+                env->DeleteLocalRef(obj_activity_manager);
+            }
+            env->DeleteLocalRef(str_svc);
+        }
+        env->DeleteLocalRef(context);
+
+        // Remove exception
+        if(env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Memory monitor %s, trim level %s"),
+                obj_memory_info_ != nullptr ? TEXT("available") : TEXT("unavailable"),
+                obj_process_info_ != nullptr ? TEXT("available") : TEXT("unavailable"));
+    }
+#endif
+}
+
+// Called on the sampler thread. getMemoryInfo() and getMyMemoryState() go
+// through binder like the thermal headroom.
+void ADPFManager::SampleMemory(ADPFThermalSnapshot& snapshot) const {
+#if PLATFORM_ANDROID
+    if (obj_memory_info_ == nullptr || CVarAndroidPerformanceMemoryMonitor.GetValueOnAnyThread() == 0) {
+        return;
+    }
+    if (JNIEnv* env = FAndroidApplication::GetJavaEnv()) {
+        env->CallVoidMethod(obj_activity_manager_, get_memory_info_, obj_memory_info_);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            return;
+        }
+        snapshot.memory_available_mb = static_cast<int32>(env->GetLongField(obj_memory_info_, avail_mem_field_) >> 20);
+        snapshot.memory_total_mb = static_cast<int32>(env->GetLongField(obj_memory_info_, total_mem_field_) >> 20);
+        snapshot.memory_threshold_mb = static_cast<int32>(env->GetLongField(obj_memory_info_, threshold_field_) >> 20);
+        snapshot.low_memory = env->GetBooleanField(obj_memory_info_, low_memory_field_) != JNI_FALSE;
+
+        if (obj_process_info_ != nullptr) {
+            env->CallStaticVoidMethod(static_cast<jclass>(cls_activity_manager_), get_my_memory_state_, obj_process_info_);
+            if (env->ExceptionCheck()) {
+                env->ExceptionClear();
+            } else {
+                snapshot.trim_level = env->GetIntField(obj_process_info_, last_trim_level_field_);
+            }
+        }
+    }
+#endif
+}
+
+// Pressure level from 0 to 3 for an onTrimMemory() level.
+static int32 GetTrimLevelPressure(int32 trim_level) {
+    // TRIM_MEMORY_UI_HIDDEN and the levels above it are sent in the
+    // background, they say nothing about the running game.
+    if (trim_level >= 20) {
+        return 0;
+    }
+    // TRIM_MEMORY_RUNNING_CRITICAL, _LOW and _MODERATE.
+    if (trim_level >= 15) {
+        return 3;
+    }
+    if (trim_level >= 10) {
+        return 2;
+    }
+    return trim_level >= 5 ? 1 : 0;
+}
+
+// The higher of the trim level pressure and the available memory pressure.
+int32 ADPFManager::GetMemoryPressureLevel(const ADPFThermalSnapshot& snapshot) const {
+    if (snapshot.low_memory) {
+        return 3;
+    }
+    int32 pressure = GetTrimLevelPressure(snapshot.trim_level);
+    if (snapshot.memory_available_mb >= 0 && snapshot.memory_threshold_mb > 0) {
+        const float ratio = static_cast<float>(snapshot.memory_available_mb) / snapshot.memory_threshold_mb;
+        for (int32 level = 3; level > pressure; --level) {
+            if (ratio < ListAndroidPerformanceMemoryAvailThresholds.Get(level - 1, 0.0f)) {
+                pressure = level;
+                break;
+            }
+        }
+    }
+    return pressure;
+}
+
+// A higher pressure is applied right away. A lower one only after it has
+// lasted kMemoryPressureReleaseSeconds, so the quality doesn't bounce while
+// the system reclaims memory.
+void ADPFManager::UpdateMemoryPressure(int64 current_clock) {
+    ADPFThermalSnapshot snapshot = thermal_sampler_.GetSnapshot();
+    if (stale_trim_level_ >= 0) {
+        if (snapshot.trim_level == stale_trim_level_) {
+            snapshot.trim_level = 0;
+        } else {
+            stale_trim_level_ = -1;
+        }
+    }
+    const int32 pressure = CVarAndroidPerformanceMemoryMonitor.GetValueOnGameThread() != 0 ?
+            GetMemoryPressureLevel(snapshot) : 0;
+    if (pressure > memory_pressure_) {
+        memory_pressure_lower_since_ = -1;
+        ApplyMemoryPressure(pressure);
+    } else if (pressure < memory_pressure_) {
+        if (memory_pressure_lower_since_ < 0) {
+            memory_pressure_lower_since_ = current_clock;
+        } else if (current_clock - memory_pressure_lower_since_ >= SecondsToNanos(kMemoryPressureReleaseSeconds)) {
+            memory_pressure_lower_since_ = -1;
+            ApplyMemoryPressure(pressure);
+        }
+    } else {
+        memory_pressure_lower_since_ = -1;
+    }
+}
+
+void ADPFManager::ApplyMemoryPressure(int32 pressure) {
+    const ADPFThermalSnapshot snapshot = thermal_sampler_.GetSnapshot();
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Memory pressure %d -> %d, available %dMB of %dMB, threshold %dMB, trim level %d"),
+            memory_pressure_, pressure, snapshot.memory_available_mb, snapshot.memory_total_mb,
+            snapshot.memory_threshold_mb, snapshot.trim_level);
+    ADPF_RECORD_EVENT(TEXT("ADPF memory pressure %d"), pressure);
+    const bool rising = pressure > memory_pressure_;
+    memory_pressure_ = pressure;
+    memory_quality_cap_ = FMath::Clamp(ListAndroidPerformanceMemoryQualityCaps.Get(pressure, max_quality_count - 1),
+            0, max_quality_count - 1);
+
+    // A replay only moves the quality cap.
+    if (!IsReplayingThermalTrace()) {
+        ScaleStreamingPool(pressure);
+    }
+
+    // Let the engine and the game drop what they can rebuild, and collect
+    // the objects they let go of.
+    if (rising && pressure >= 2 && !IsReplayingThermalTrace()) {
+        FCoreDelegates::GetMemoryTrimDelegate().Broadcast();
+        if (pressure >= 3 && GEngine != nullptr) {
+            GEngine->ForceGarbageCollection(true);
+        }
+    }
+
+    // Drop below a lowered cap now, texture and shadow groups first. The
+    // governor raises the level again as usual when the cap goes up.
+    if (current_quality_level > GetQualityCap()) {
+        ApplyQualityLevel(GetQualityCap());
+    }
+}
+
+// Scale r.Streaming.PoolSize from the size it had before the pressure
+// started. It's restored once the pressure is gone.
+void ADPFManager::ScaleStreamingPool(int32 pressure) {
+    IConsoleVariable* pool_size = IConsoleManager::Get().FindConsoleVariable(TEXT("r.Streaming.PoolSize"));
+    if (pool_size == nullptr) {
+        return;
+    }
+    // The size is written with game override priority. Console variables
+    // ini, command line, code and console settings still win.
+    const uint32 priority = pool_size->GetFlags() & ECVF_SetByMask;
+    if (priority > ECVF_SetByGameOverride) {
+        return;
+    }
+    if (base_streaming_pool_size_ < 0) {
+        // A size of 0 or less leaves the pool size to the platform, there's
+        // nothing to scale.
+        if (pressure == 0 || pool_size->GetInt() <= 0) {
+            return;
+        }
+        base_streaming_pool_size_ = pool_size->GetInt();
+        base_streaming_pool_priority_ = priority;
+    }
+
+    const float scale = pressure == 0 ? 1.0f :
+            FMath::Clamp(ListAndroidPerformanceMemoryPoolScales.Get(pressure, 1.0f), 0.1f, 1.0f);
+    const int32 size = FMath::Max(FMath::RoundToInt(base_streaming_pool_size_ * scale), 1);
+    if (size != pool_size->GetInt()) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Texture streaming pool %dMB -> %dMB"), pool_size->GetInt(), size);
+        pool_size->Set(size, ECVF_SetByGameOverride);
+    }
+    if (pressure == 0) {
+        // Give the size back at its own priority, so device profiles and
+        // scalability can set it again.
+        pool_size->SetFlags(static_cast<EConsoleVariableFlags>(
+                (pool_size->GetFlags() & ~ECVF_SetByMask) | base_streaming_pool_priority_));
+        base_streaming_pool_size_ = -1;
+    }
+}
+
+void ADPFManager::SetTargetWorkDuration(const float max_fps) {
+    prev_max_fps = max_fps;
+    target_controller_.SetMaxFPS(max_fps);
+    base_target_work_duration_ns_ = target_controller_.GetFrameIntervalNs();
+    ApplyTargetWorkDuration();
+}
+
+void ADPFManager::ApplyTargetWorkDuration() {
+    int64 target_duration_ns = policy_target_scale_ > 0.0f ?
+            static_cast<int64>(target_controller_.GetFrameIntervalNs() * policy_target_scale_) :
+            target_controller_.GetTargetNs();
+    if (workload_boost_end_clock_ > 0) {
+        const float scale = FMath::Clamp(CVarAndroidPerformanceWorkloadBoostTargetScale.GetValueOnAnyThread(), 0.1f, 1.0f);
+        target_duration_ns = static_cast<int64>(target_duration_ns * scale);
+    }
+    target_work_duration_ns_.store(target_duration_ns, std::memory_order_relaxed);
+    // The live sessions keep their target during a replay.
+    if (IsReplayingThermalTrace()) {
+        return;
+    }
+
+    // Each primary thread gets its share, the rest is slack for the later
+    // pipeline stages.
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        thread_target_work_duration_ns_[i].store(
+                static_cast<int64>(target_duration_ns * ADPFTargetController::GetBudgetShare(i)), std::memory_order_relaxed);
+    }
+}
+
+void ADPFManager::NotifyWorkload(EADPFWorkloadHint hint, bool cpu, bool gpu) {
+#if PLATFORM_ANDROID
+    if (CVarAndroidPerformanceEnabled.GetValueOnAnyThread() == 0 ||
+            CVarAndroidPerformanceHintEnabled.GetValueOnAnyThread() == 0 || (!cpu && !gpu)) {
+        return;
+    }
+
+    if (perfhint_backend_ == EPerfHintBackend::Native && ADPFNativeApi::Get().IsWorkloadHintAvailable()) {
+        // The GPU part only goes to the session that reports the GPU duration.
+        for (int32 i = 0; i < perfhint_group_count_; ++i) {
+            PerfHintThreadGroup& group = perfhint_groups_[i];
+            if (!group.has_primary) {
+                continue;
+            }
+            const bool group_gpu = gpu && group.primary == gpu_reporting_thread_;
+            if (cpu || group_gpu) {
+                group.pending_workload_hints.fetch_or(WorkloadHintBits(hint, cpu, group_gpu), std::memory_order_release);
+            }
+            // This is the game thread's own session, send it now. A blocking
+            // map load doesn't end the frame until it's done.
+            if (group.primary == EPerfHintThread::Game && perfhint_sessions_ready_.load(std::memory_order_acquire)) {
+                SendPendingWorkloadHints(group);
+            }
+        }
+        return;
+    }
+
+    // Fallback, ask for more performance by tightening the target duration.
+    if (hint == EADPFWorkloadHint::Reset) {
+        workload_boost_end_clock_ = 0;
+    } else {
+        const float duration = hint == EADPFWorkloadHint::Spike ? kWorkloadSpikeBoostSeconds :
+                FMath::Max(CVarAndroidPerformanceWorkloadBoostDuration.GetValueOnAnyThread(), 0.0f);
+        workload_boost_end_clock_ = FMath::Max(workload_boost_end_clock_, Clock() + SecondsToNanos(duration));
+    }
+    ApplyTargetWorkDuration();
+#endif
+}
+
+void ADPFManager::SendPendingWorkloadHints(PerfHintThreadGroup& group) {
+    const uint32 hints = group.pending_workload_hints.exchange(0, std::memory_order_acquire);
+    if (hints == 0 || group.session.native_session == nullptr) {
+        return;
+    }
+    ADPF_SCOPE(WorkloadHint);
+
+    static const char* const kDebugNames[] = { "ADPFWorkloadIncrease", "ADPFWorkloadSpike", "ADPFWorkloadReset" };
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    decltype(api.notify_workload_increase) functions[] = {
+        api.notify_workload_increase, api.notify_workload_spike, api.notify_workload_reset };
+    for (int32 i = 0; i < static_cast<int32>(EADPFWorkloadHint::Count); ++i) {
+        const uint32 bits = hints >> (i * 2);
+        const bool cpu = (bits & 1u) != 0;
+        const bool gpu = (bits & 2u) != 0;
+        if (cpu || gpu) {
+            const int result = functions[i](group.session.native_session, cpu, gpu, kDebugNames[i]);
+            if (result != 0) {
+                UE_LOG(LogAndroidPerformance, Verbose, TEXT("%s failed: %d"), ANSI_TO_TCHAR(kDebugNames[i]), result);
+            }
+        }
+    }
+}
+
+void ADPFManager::StartStartupBoost() {
+#if PLATFORM_ANDROID
+    if (CVarAndroidPerformanceStartupBoost.GetValueOnGameThread() == 0 ||
+            CVarAndroidPerformanceHintEnabled.GetValueOnGameThread() == 0 || perfhint_backend_ != EPerfHintBackend::Native) {
+        return;
+    }
+
+    TArray<EPerfHintThread> member_threads;
+    TArray<FString> member_name_prefixes;
+    TArray<FString> tokens;
+    CVarAndroidPerformanceStartupBoostThreads.GetValueOnGameThread().ParseIntoArray(tokens, TEXT(","));
+    for (FString& token : tokens) {
+        token.TrimStartAndEndInline();
+        EPerfHintThread thread;
+        if (ParsePrimaryThread(token, thread)) {
+            member_threads.AddUnique(thread);
+        } else if (!token.IsEmpty()) {
+            member_name_prefixes.Add(token);
+        }
+    }
+
+    // The render and RHI threads may not exist yet, they are picked up by
+    // the boost thread's rescans.
+    auto collect = [this, member_threads, member_name_prefixes](TArray<int32>& out_thread_ids) {
+        PerfHintThreadGroup group;
+        group.has_primary = false;
+        group.member_threads = member_threads;
+        group.member_name_prefixes = member_name_prefixes;
+        CollectThreadIds(group, out_thread_ids);
+    };
+    if (startup_boost_.Start(MoveTemp(collect))) {
+        startup_boost_start_clock_ = Clock();
+    }
+#endif
+}
+
+void ADPFManager::EndStartupBoost() {
+    if (startup_boost_.IsRunning()) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("First interactive frame after %.2fs"),
+                NanosToSeconds(Clock() - startup_boost_start_clock_));
+        startup_boost_.Shutdown();
+    }
+}
+
+void ADPFManager::UpdateStartupBoost(int64 current_clock) {
+    const bool timed_out = current_clock - startup_boost_start_clock_ >=
+            SecondsToNanos(CVarAndroidPerformanceStartupBoostTimeout.GetValueOnGameThread());
+    const bool map_loaded = CVarAndroidPerformanceStartupBoostEnd.GetValueOnGameThread() == 0 && startup_boost_map_loaded_;
+    if (timed_out || map_loaded) {
+        EndStartupBoost();
+    }
+}
+
+void ADPFManager::RegisterLifecycleHooks() {
+    FCoreDelegates::ApplicationWillEnterBackgroundDelegate.AddRaw(this, &ADPFManager::OnApplicationWillEnterBackground);
+    FCoreDelegates::ApplicationHasEnteredForegroundDelegate.AddRaw(this, &ADPFManager::OnApplicationHasEnteredForeground);
+    FCoreDelegates::OnSystemResolutionChanged.AddRaw(this, &ADPFManager::OnSystemResolutionChanged);
+}
+
+void ADPFManager::UnregisterLifecycleHooks() {
+    FCoreDelegates::ApplicationWillEnterBackgroundDelegate.RemoveAll(this);
+    FCoreDelegates::ApplicationHasEnteredForegroundDelegate.RemoveAll(this);
+    FCoreDelegates::OnSystemResolutionChanged.RemoveAll(this);
+}
+
+// Sessions kept while paused boost whatever the threads still do and waste
+// power. The next Monitor() after resume creates them with the threads of
+// that time.
+void ADPFManager::OnApplicationWillEnterBackground() {
+    // The app may be killed in the background without a shutdown.
+    DumpFrameTimeStats();
+    SaveThermalModel();
+    thermal_trace_recorder_.Flush();
+    ClosePerfHintSessions();
+}
+
+// getMyMemoryState() keeps reporting the last trim level, which may be one
+// from before or during the background.
+void ADPFManager::OnApplicationHasEnteredForeground() {
+    stale_trim_level_ = thermal_sampler_.GetSnapshot().trim_level;
+    // The display may have changed while in the background.
+    target_controller_.InvalidateRefreshRate();
+}
+
+// A display mode change may come with another refresh rate.
+void ADPFManager::OnSystemResolutionChanged(uint32 width, uint32 height) {
+    target_controller_.InvalidateRefreshRate();
+}
+
+void ADPFManager::ClosePerfHintSessions() {
+    if (!initialized_performance_hint_manager) {
+        return;
+    }
+
+    // Let a session creation in flight finish first.
+    if (perfhint_init_task_.IsValid()) {
+        perfhint_init_task_.Wait();
+        perfhint_init_task_ = UE::Tasks::FTask();
+    }
+
+    // Stop new reports, then wait for the render and RHI threads to finish
+    // any report in flight, before the sessions go away under them.
+    perfhint_sessions_ready_.store(false, std::memory_order_release);
+    FlushRenderingCommands();
+
+    for (int32 i = 0; i < perfhint_group_count_; ++i) {
+        PerfHintThreadGroup& group = perfhint_groups_[i];
+        ReleasePerfHintSession(group.session);
+        group.thread_ids.Reset();
+        group.pending_thread_ids.Reset();
+        group.has_pending_thread_ids.store(false, std::memory_order_relaxed);
+        group.pending_workload_hints.store(0, std::memory_order_relaxed);
+        group.pending_power_efficiency.store(-1, std::memory_order_relaxed);
+    }
+    for (int32 i = 0; i < static_cast<int32>(EPerfHintThread::Count); ++i) {
+        perfhint_primary_groups_[i] = nullptr;
+    }
+    perfhint_group_count_ = 0;
+    initialized_performance_hint_manager = false;
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Perf hint sessions closed."));
+}
+
+void ADPFManager::RegisterWorkloadHooks() {
+    FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &ADPFManager::OnPreLoadMap);
+    FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &ADPFManager::OnPostLoadMapWithWorld);
+    FCoreDelegates::OnAsyncLoadingFlushUpdate.AddRaw(this, &ADPFManager::OnAsyncLoadingFlushUpdate);
+}
+
+void ADPFManager::UnregisterWorkloadHooks() {
+    FCoreUObjectDelegates::PreLoadMap.RemoveAll(this);
+    FCoreUObjectDelegates::PostLoadMapWithWorld.RemoveAll(this);
+    FCoreDelegates::OnAsyncLoadingFlushUpdate.RemoveAll(this);
+}
+
+void ADPFManager::OnPreLoadMap(const FString& map_name) {
+    ReportGameState(true);
+    if (CVarAndroidPerformanceLoadMapWorkloadHints.GetValueOnAnyThread() != 0) {
+        NotifyWorkload(EADPFWorkloadHint::Increase, true, true);
+    }
+}
+
+void ADPFManager::OnPostLoadMapWithWorld(UWorld* world) {
+    // The next Monitor() is the first frame after the first map load.
+    startup_boost_map_loaded_ = true;
+    ReportGameState(false);
+    // The frames after a load don't look like the ones before it.
+    if (CVarAndroidPerformanceLoadMapWorkloadHints.GetValueOnAnyThread() != 0) {
+        NotifyWorkload(EADPFWorkloadHint::Reset, true, true);
+    }
+}
+
+void ADPFManager::OnAsyncLoadingFlushUpdate() {
+    // A blocking load holds the game thread in one long frame, and the frame
+    // hooks don't fire until it ends. Report the game thread's work once per
+    // present interval meanwhile, so its session doesn't go quiet.
+    if (!game_frame_timer_.IsRunning() ||
+            GetMonotonicNanos() - game_frame_timer_.start_timestamp_ns < base_target_work_duration_ns_) {
+        return;
     }
+    const int64 start_timestamp_ns = game_frame_timer_.start_timestamp_ns;
+    const int64 duration_ns = game_frame_timer_.Stop(GetThreadIdleCycles());
+    game_frame_timer_.Start(GetThreadIdleCycles());
+    OnWorkMeasured(EPerfHintThread::Game, duration_ns, start_timestamp_ns);
 }
@@ -17,19 +17,223 @@
 #ifndef ADPF_MANAGER_H_
 #define ADPF_MANAGER_H_
 
+#include <atomic>
+#include <time.h>
+
+#if PLATFORM_ANDROID
 #include <android/log.h>
 #include <android/thermal.h>
 #include <jni.h>
 #include <android_native_app_glue.h>
+#else
+// The manager compiles to no-ops outside Android. These stand in for the
+// platform types its members are declared with.
+struct AThermalManager;
+typedef void* jobject;
+typedef struct _jmethodID* jmethodID;
+typedef struct _jfieldID* jfieldID;
+typedef int64 jlong;
+// Values of the NDK AThermalStatus, for replays.
+enum AThermalStatus {
+    ATHERMAL_STATUS_ERROR = -1,
+    ATHERMAL_STATUS_NONE = 0,
+    ATHERMAL_STATUS_LIGHT = 1,
+    ATHERMAL_STATUS_MODERATE = 2,
+    ATHERMAL_STATUS_SEVERE = 3,
+    ATHERMAL_STATUS_CRITICAL = 4,
+    ATHERMAL_STATUS_EMERGENCY = 5,
+    ATHERMAL_STATUS_SHUTDOWN = 6,
+};
+#endif
 
 #include "Scalability.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/CriticalSection.h"
+#include "Containers/CircularQueue.h"
+#include "Tasks/Task.h"
+#include "ADPFNativeApi.h"
+#include "ADPFCVarList.h"
+#include "ADPFThermalSampler.h"
+#include "ADPFQualityGovernor.h"
+#include "ADPFQualityLadder.h"
+#include "ADPFResolutionController.h"
+#include "ADPFTargetController.h"
+#include "ADPFDeviceProfile.h"
+#include "ADPFStartupBoost.h"
+#include "ADPFStats.h"
+#include "ADPFFrameHistogram.h"
+#include "ADPFThermalTrace.h"
+#include "ADPFThermalModel.h"
+#include "ADPFPolicies.h"
+
+class UWorld;
 
+#if PLATFORM_ANDROID
 // Forward declarations of functions that need to be in C decl.
 extern "C" {
 void nativeThermalStatusChanged(JNIEnv* env, jclass cls, int32_t thermalState);
 void nativeRegisterThermalStatusListener(JNIEnv* env, jclass cls);
 void nativeUnregisterThermalStatusListener(JNIEnv* env, jclass cls);
 }
+#endif
+
+// Backend used to talk to the performance hint service. It's chosen once
+// when the listener is registered.
+enum class EPerfHintBackend : uint8 {
+    None,
+    // NDK APerformanceHint API, available from API 33.
+    Native,
+    // PerformanceHintManager through JNI, fallback for API 31 and 32.
+    Java,
+};
+
+// Handles of a single performance hint session. Only the members of the
+// selected backend are used.
+struct PerfHintSession {
+    APerformanceHintSession* native_session = nullptr;
+    // Reused for every reportActualWorkDuration2() call, API 35.
+    AWorkDuration* work_duration = nullptr;
+    jobject obj_session = nullptr;
+    jmethodID report_actual_work_duration = 0;
+    jmethodID update_target_work_duration = 0;
+    jmethodID set_threads = 0;
+    jmethodID close = 0;
+    // Last target duration sent to the session. Only touched by the thread
+    // that reports to the session.
+    int64 reported_target_duration_ns = 0;
+
+    bool IsValid() const { return native_session != nullptr || obj_session != nullptr; }
+};
+
+// Threads with a measured frame duration. Each one can lead a thread group.
+enum class EPerfHintThread : uint8 {
+    Game,
+    Render,
+    RHI,
+    Count,
+};
+
+// A hint session over a primary thread and the threads grouped with it. The
+// primary thread's frame duration is reported to the session, and the
+// primary thread makes every call on the session.
+// Power efficiency groups have no primary thread. Nothing is reported to
+// their session, which only asks the system to prefer power efficiency for
+// the threads, and the game thread makes every call on it.
+struct PerfHintThreadGroup {
+    bool has_primary = true;
+    bool prefer_power_efficiency = false;
+    EPerfHintThread primary = EPerfHintThread::Game;
+    // Other primary threads and thread name prefixes in the group.
+    TArray<EPerfHintThread> member_threads;
+    TArray<FString> member_name_prefixes;
+    // Sorted thread ids last collected by the game thread.
+    TArray<int32> thread_ids;
+    PerfHintSession session;
+
+    // Thread list waiting to be applied by the primary thread.
+    FCriticalSection pending_lock;
+    TArray<int32> pending_thread_ids;
+    std::atomic<bool> has_pending_thread_ids{false};
+
+    // Workload hints waiting to be sent by the primary thread, see
+    // WorkloadHintBits().
+    std::atomic<uint32> pending_workload_hints{0};
+    // Power efficiency preference waiting to be applied by the primary
+    // thread, -1 if none.
+    std::atomic<int32> pending_power_efficiency{-1};
+};
+
+// Governor limits chosen for the game mode picked in the Game Dashboard.
+struct ADPFGameModeProfile {
+    // Highest quality level the governor may use.
+    int32 max_quality_level = INT32_MAX;
+    // Max FPS cap, 0 if none.
+    int32 frame_rate_cap = 0;
+    // Primary thread sessions prefer power efficiency, Android 15 and later.
+    bool prefer_power_efficiency = false;
+};
+
+// Hint about a change of work that the frame durations don't show yet.
+enum class EADPFWorkloadHint : uint8 {
+    // The work is going to go up for a while, e.g. a map load.
+    Increase,
+    // A one off burst of work, e.g. a shader compile.
+    Spike,
+    // The work changed in a way the earlier durations don't predict, e.g.
+    // a map load finished.
+    Reset,
+    Count,
+};
+
+// Pending hint bits of PerfHintThreadGroup::pending_workload_hints, one bit
+// for the CPU and one for the GPU of each hint.
+inline uint32 WorkloadHintBits(EADPFWorkloadHint hint, bool cpu, bool gpu) {
+    const uint32 shift = static_cast<uint32>(hint) * 2;
+    return ((cpu ? 1u : 0u) << shift) | ((gpu ? 2u : 0u) << shift);
+}
+
+// A thermal status change, as received from the listener.
+struct ADPFThermalEvent {
+    // enum for AThermalStatus
+    int32 status = 0;
+    // Clock() when the listener was called.
+    int64 timestamp_ns = 0;
+    // GFrameCounter when the game thread applied the change.
+    uint64 frame = 0;
+};
+
+// CLOCK_MONOTONIC in nanoseconds, the time base of the performance hint API.
+inline int64 GetMonotonicNanos() {
+#if PLATFORM_ANDROID
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+    return CyclesToNanos(FPlatformTime::Cycles64());
+#endif
+}
+
+// Nanoseconds since the plugin was loaded, the time base of the governor and
+// of the thermal samples. It stays exact over long sessions, unlike float
+// seconds.
+int64 Clock();
+
+inline int64 SecondsToNanos(double seconds) {
+    return static_cast<int64>(seconds * 1e9);
+}
+
+inline double NanosToSeconds(int64 nanos) {
+    return static_cast<double>(nanos) * 1e-9;
+}
+
+// Measures the busy time between Start() and Stop() in nanoseconds: the wall
+// time less the idle cycles the measured thread counted meanwhile. Both are
+// called on the measured thread with its current idle counter. min_idle_ns
+// is idle time known from another source that the counter may have missed.
+struct WorkDurationTimer {
+    void Start(uint32 idle_cycles) {
+        start_cycles = FPlatformTime::Cycles64();
+        start_timestamp_ns = GetMonotonicNanos();
+        start_idle_cycles = idle_cycles;
+    }
+    bool IsRunning() const { return start_cycles != 0; }
+    int64 Stop(uint32 idle_cycles, int64 min_idle_ns = 0) {
+        const uint64 end_cycles = FPlatformTime::Cycles64();
+        const int64 duration_ns = CyclesToNanos(end_cycles - start_cycles);
+        // The engine zeroes the idle counters once per frame. A counter
+        // below its start value was reset, and only the time after the reset
+        // is known.
+        const uint32 idle_delta = idle_cycles >= start_idle_cycles ? idle_cycles - start_idle_cycles : idle_cycles;
+        const int64 idle_ns = FMath::Max(static_cast<int64>(FPlatformTime::ToSeconds(idle_delta) * 1e9), min_idle_ns);
+        start_cycles = 0;
+        return FMath::Max<int64>(duration_ns - idle_ns, 0);
+    }
+
+    uint64 start_cycles = 0;
+    uint32 start_idle_cycles = 0;
+    // Monotonic start of the last started period, kept after Stop().
+    int64 start_timestamp_ns = 0;
+};
 
 /*
  * ADPFManager class anages the ADPF APIs.
@@ -50,74 +254,491 @@ class ADPFManager {
     bool registerListener();
     bool unregisterListener();
 
+    // Apply the first device profile of the engine ini that matches the SoC
+    // model or GPU family. Call once before registerListener().
+    void LoadDeviceProfile();
+
     // Invoke the method periodically (once a frame) to monitor
-    // the device's thermal throttling status.
+    // the device's thermal throttling status. Calls after the first one in
+    // the same frame do nothing.
     void Monitor();
 
+    // Bind/unbind the frame boundary hooks that report each thread's work
+    // duration from the thread that did the work.
+    void RegisterFrameHooks();
+    void UnregisterFrameHooks();
+
     // Method to set thermal status. Need to be public since the method
-    // is called from C native listener.
+    // is called from C native listener. The change is queued and applied by
+    // the game thread on the next Monitor() call.
     void SetThermalStatus(const int32_t i);
 
+    // Copy the latest thermal status changes, oldest first. Game thread only.
+    void GetThermalStatusHistory(TArray<ADPFThermalEvent>& out_history) const;
+
+    // Frame time percentiles and jank count of the frames spent in a thermal
+    // status and quality level. Returns false for an index out of range.
+    // Game thread only.
+    bool GetFrameTimeStats(int32 thermal_status, int32 quality_level, ADPFFrameTimeStats& out_stats) const;
+
+    // Log the frame time stats of every state with frames, and the cost of
+    // each timed scope per frame. Game thread only.
+    void DumpFrameTimeStats() const;
+
+    // Record the thermal samples and frame timings of the session to a
+    // trace file. An empty path picks a file in the profiling directory.
+    // Game thread only.
+    bool StartThermalTraceRecording(const FString& path);
+    void StopThermalTraceRecording();
+
+    // Play a recorded trace through the governor in place of the platform,
+    // one frame per Monitor() call, or the whole trace at once if fast.
+    // Works on any platform. Game thread only.
+    bool StartThermalTraceReplay(const FString& path, bool fast);
+    bool IsReplayingThermalTrace() const { return thermal_trace_reader_.IsOpen(); }
+
+    // Planned quality mode plans for a session or match that ends this many
+    // seconds from now, e.g. call it at the start of a match. Game thread
+    // only.
+    void SetExpectedSessionLength(float seconds);
+
+    // Log or forget the learned thermal model. Game thread only.
+    void DumpThermalModel() const;
+    void ResetThermalModel();
+
+    // Policies a project registers, see FAndroidPerformancePolicyRegistry.
+    // Game thread only.
+    void RegisterPolicy(FName name, TSharedRef<IAndroidPerformancePolicy> policy);
+    void UnregisterPolicy(FName name);
+    void UnregisterAllPolicies();
+
+    // Latest thermal sample. The sampler keeps running while the plugin is
+    // disabled.
+    ADPFThermalSnapshot GetThermalSnapshot() const { return thermal_sampler_.GetSnapshot(); }
+    // Quality level changes since startup or the start of a replay.
+    uint32 GetQualityChangeCount() const { return quality_change_count_; }
+    // Frames longer than this count as a jank.
+    float GetJankThresholdMs() const;
+
+    // Apply the highest quality level and lift the frame rate cap right
+    // away, e.g. before disabling the plugin. Game thread only.
+    void RestoreDefaultQuality();
+
+    // Get current thermal status, headroom and quality level. Game thread
+    // only.
+    int32_t GetThermalStatus() const { return thermal_status_; }
+    float GetThermalHeadroom() const { return thermal_headroom_; }
+    int32_t GetQualityLevel() const { return current_quality_level; }
+    // Memory pressure from 0 (none) to 3 (critical). Game thread only.
+    int32 GetMemoryPressure() const { return memory_pressure_; }
+
+    // Share of the full workload the device can sustain now, from 1 at the
+    // highest quality level with thermal headroom to spare down to 0.
+    // Updated once a frame, any thread can read it.
+    float GetPerformanceBudget() const { return performance_budget_.load(std::memory_order_relaxed); }
+
+    // Broadcast on the game thread with the quality level and the budget,
+    // when the level changes or the budget has moved by a step.
+    DECLARE_MULTICAST_DELEGATE_TwoParams(FOnBudgetChanged, int32, float);
+    FOnBudgetChanged& OnBudgetChanged() { return on_budget_changed_; }
+
+    // Tell the system that the work is about to change. Each session sends
+    // the hint with its next report. Without the Android 16 workload hints,
+    // Increase and Spike tighten the target duration for a while and Reset
+    // restores it. Game thread only.
+    void NotifyWorkload(EADPFWorkloadHint hint, bool cpu, bool gpu);
+
+    // Boost the loading threads from startup until the first interactive
+    // frame, the normal sessions are created after that. EndStartupBoost()
+    // is the first interactive frame signal. Game thread only.
+    void StartStartupBoost();
+    void EndStartupBoost();
+
+    // Bind/unbind closing the hint sessions while the app is in the
+    // background. They are recreated with the current threads on resume.
+    void RegisterLifecycleHooks();
+    void UnregisterLifecycleHooks();
+
+    // Bind/unbind the workload hints sent around map loads, and the game
+    // thread reports during blocking loads.
+    void RegisterWorkloadHooks();
+    void UnregisterWorkloadHooks();
+
     // Method to retrieve thermal manager. The API is used to register/unregister
     // callbacks from C API.
     AThermalManager* GetThermalManager() { return thermal_manager_; }
 
  private:
-    inline jlong fpsToNanosec(const float maxFPS);
-    void saveQualityLevel(const int32_t warning_level);
-    void saveQualityLevel(const float head_room);
+    void ApplyQualityLevel(int32_t new_target);
+    // Highest quality level the game mode and the memory pressure allow.
+    int32 GetQualityCap() const;
+
+    // Thermal frame rate cap.
+    int32 GetFrameRateCapForThermalStatus() const;
+    void UpdateFrameRateCap();
+
+    // Publish the target duration for max_fps to the reporting threads,
+    // tightened while a workload boost is active.
+    void SetTargetWorkDuration(const float max_fps);
+    void ApplyTargetWorkDuration();
+
+    void UpdateStartupBoost(int64 current_clock);
+
+    // Game mode and game state.
+    void InitializeGameManager();
+    int32 QueryGameMode() const;
+    void ApplyGameMode(int32 game_mode);
+    void ReportGameState(bool loading);
+
+    // Memory pressure. The memory info is sampled with the thermal headroom,
+    // and the game thread applies the pressure level with the quality caps.
+    void InitializeMemoryMonitor();
+    void SampleMemory(ADPFThermalSnapshot& snapshot) const;
+    int32 GetMemoryPressureLevel(const ADPFThermalSnapshot& snapshot) const;
+    void UpdateMemoryPressure(int64 current_clock);
+    void ApplyMemoryPressure(int32 pressure);
+    void ScaleStreamingPool(int32 pressure);
+
+    // Workload hints.
+    void SendPendingWorkloadHints(PerfHintThreadGroup& group);
+    void OnPreLoadMap(const FString& map_name);
+    void OnPostLoadMapWithWorld(UWorld* world);
+    void OnAsyncLoadingFlushUpdate();
+
+    // Predictive mode.
+    void ParseThermalForecastHorizons(ADPFThermalSnapshot& snapshot) const;
+    float PredictThermalHeadroom(const ADPFThermalSnapshot& snapshot) const;
 
-    // Update thermal headroom every 15 seconds.
+    // Planned mode. The model learns from every mode, and is saved when the
+    // app goes to the background or shuts down.
+    void LearnThermalModel();
+    void SaveThermalModel() const;
+    float GetRemainingSessionSeconds();
+
+    // Governor policy, see AndroidPerformancePolicy.h.
+    void SelectCustomPolicy();
+    void EvaluatePolicy(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision);
+    void ApplyPolicyDecision(const FAndroidPerformancePolicyDecision& decision, bool severe_throttling);
+    // Drop the overrides of the last decision and the workload boost, and
+    // reset the selected policy. The targets aren't published again.
+    void ResetPolicyOverrides();
+
+    // Update thermal headroom every 15 seconds, unless the device profile
+    // sets another interval.
     static constexpr int32_t kThermalHeadroomUpdateThreshold = 15;
 
     // Get current thermal headroom.
     static constexpr int32_t kThermalHeadroomForecastSeconds = 0;
 
+    // Seconds a spike hint tightens the target duration in the fallback.
+    static constexpr float kWorkloadSpikeBoostSeconds = 1.0f;
+
+    // Smallest performance budget change that is broadcast.
+    static constexpr float kBudgetBroadcastStep = 0.05f;
+
+    // Seconds the memory pressure has to stay lower before it's released.
+    static constexpr float kMemoryPressureReleaseSeconds = 10.0f;
+
     // Ctor. It's private since the class is designed as a singleton.
     ADPFManager();
 
     // Functions to initialize ADPF API's calls.
     bool InitializePowerManager();
     float UpdateThermalStatusHeadRoom();
+    float QueryThermalHeadroom(const int32_t forecast_seconds) const;
+    void SampleThermalStatus(ADPFThermalSnapshot& snapshot) const;
+    void SampleSystemHealth(ADPFThermalSnapshot& snapshot) const;
+    void InitializeSystemHealth();
+    EADPFBottleneck GetBottleneck() const;
+    void SelectPerformanceHintBackend();
+    void StartPerfHintSessions();
+    void FinishPerfHintSessions();
     bool InitializePerformanceHintManager();
+    bool InitializeNativePerformanceHintManager();
+    bool InitializeJavaPerformanceHintManager();
+    bool CreatePerfHintSession(const TArray<int32>& thread_ids, PerfHintSession& session,
+            bool prefer_power_efficiency = false);
+    void SetPerfHintSessionThreads(const TArray<int32>& thread_ids, PerfHintSession& session,
+            bool prefer_power_efficiency = false);
+    void ReleasePerfHintSession(PerfHintSession& session);
+
+    // Close every session, they are created again by the next Monitor().
+    // Game thread only.
+    void ClosePerfHintSessions();
+    bool PrimaryThreadsChanged() const;
+    void OnApplicationWillEnterBackground();
+    void OnApplicationHasEnteredForeground();
+    void OnSystemResolutionChanged(uint32 width, uint32 height);
+
+    // Thread groups.
+    void ParseThreadGroups();
+    void ParsePowerEfficiencyThreadGroups();
+    void CollectThreadIds(const PerfHintThreadGroup& group, TArray<int32>& out_thread_ids) const;
+    void RescanThreadGroups();
+
+
+    // Apply the queued thermal status changes in order.
+    void DrainThermalStatusEvents();
+
+    // Add a frame time to the histograms.
+    void RecordFrameTime(float frame_ms);
+
+    void UpdatePerformanceBudget();
+
+    // The Monitor() steps that don't use the hint sessions. current_clock is
+    // in nanoseconds.
+    void UpdateGovernor(int64 current_clock, float frame_ms, int64 work_duration_ns);
 
-    // Get current thermal status and headroom.
-    int32_t GetThermalStatus() { return thermal_status_; }
-    float GetThermalHeadroom() { return thermal_headroom_; }
+    // Publish the cost of the last frame's timed scopes.
+    void RecordCost();
+
+    // Thermal trace replay. ReplayThermalTraceFrame() returns false once
+    // the trace has ended.
+    void ResetGovernorForReplay();
+    bool ReplayThermalTraceFrame();
+    void FinishThermalTraceReplay();
 
     // Indicates the start and end of the performance intensive task.
     // The methods call performance hint API to tell the performance
     // hint to the system.
     void UpdatePerfHintSession(jlong duration_ns, jlong target_duration_ns, bool update_target_duration,
-            jobject obj_perfhint_session_, jmethodID report_actual_work_duration, jmethodID update_target_work_duration);
+            const PerfHintSession& session, int64 start_timestamp_ns = 0, int64 gpu_duration_ns = 0);
+
+    // Report a measured work duration to the primary thread's group, and the
+    // current target duration if it has changed since the last report.
+    // The GPU duration of the last frame is reported with the session that
+    // submits GPU work.
+    void ReportWorkDuration(EPerfHintThread thread, int64 duration_ns, int64 start_timestamp_ns);
+    bool IsReportingEnabled() const;
+
+    // Frame boundary hooks. The game thread hooks are bound to
+    // FCoreDelegates::OnBeginFrame/OnEndFrame, the render thread hooks to
+    // OnBeginFrameRT/OnEndFrameRT. The RHI thread frame is measured by
+    // lambdas the render thread enqueues on the immediate command list. Each
+    // duration excludes the time the thread waited: task and event waits,
+    // the frame end sync and max FPS sleep of the game thread, and the GPU
+    // query and present waits of the render thread.
+    void OnWorkMeasured(EPerfHintThread thread, int64 duration_ns, int64 start_timestamp_ns);
+    void OnBeginFrame();
+    void OnEndFrame();
+    void OnBeginFrameRT();
+    void OnEndFrameRT();
 
     AThermalManager* thermal_manager_;
     bool initialized_performance_hint_manager;
-    int32_t thermal_status_; // enum for AThermalStatus
+    // Set once the hint sessions are created, read by the reporting threads.
+    std::atomic<bool> perfhint_sessions_ready_;
+    // Creates the sessions off the game thread, valid until the game thread
+    // takes them over.
+    UE::Tasks::FTask perfhint_init_task_;
+    int32_t thermal_status_; // enum for AThermalStatus, only written by the game thread
+
+    // Thermal status changes from the listener threads to the game thread.
+    // The queue is single producer, so the listeners serialize their writes.
+    static constexpr uint32 kThermalEventQueueSize = 64;
+    TCircularQueue<ADPFThermalEvent> thermal_event_queue_;
+    FCriticalSection thermal_event_producer_lock_;
+    std::atomic<uint32> dropped_thermal_events_;
+
+    // Ring of the latest applied changes, for correlating with frame times.
+    static constexpr int32 kThermalHistorySize = 32;
+    ADPFThermalEvent thermal_history_[kThermalHistorySize];
+    int32 thermal_history_count_;
+    int32 thermal_history_next_;
     float thermal_headroom_; // 0.0f ~ 1.0f, can be over 1.0f but it means THERMAL_STATUS_SEVERE 
-    float last_clock_;
+    int64 last_clock_;
+    float thermal_update_interval_;
     jobject obj_power_service_;
     jmethodID get_thermal_headroom_;
 
+    EPerfHintBackend perfhint_backend_;
+    APerformanceHintManager* perfhint_manager_;
     jobject obj_perfhint_service_;
-    jobject obj_perfhint_game_session_;
-    jobject obj_perfhint_render_session_;
-    jobject obj_perfhint_rhi_session_;
-    jmethodID report_actual_game_work_duration_;
-    jmethodID report_actual_render_work_duration_;
-    jmethodID report_actual_rhi_work_duration_;
-    jmethodID update_target_game_work_duration_;
-    jmethodID update_target_render_work_duration_;
-    jmethodID update_target_rhi_work_duration_;
+    jmethodID create_hint_session_;
+
+    static constexpr int32 kMaxPerfHintGroups = 8;
+    PerfHintThreadGroup perfhint_groups_[kMaxPerfHintGroups];
+    int32 perfhint_group_count_;
+    // Group led by each primary thread, nullptr if the thread doesn't report.
+    PerfHintThreadGroup* perfhint_primary_groups_[static_cast<int32>(EPerfHintThread::Count)];
+    int64 last_thread_scan_clock_;
+    // Primary thread ids the sessions were created for.
+    uint32 perfhint_primary_thread_ids_[static_cast<int32>(EPerfHintThread::Count)];
+    // Thread whose session gets the GPU duration, the RHI thread unless it's
+    // grouped with the render thread.
+    EPerfHintThread gpu_reporting_thread_;
     jlong preferred_update_rate_;
 
+    // Predictive mode, timestamp of the last evaluated sample and the
+    // headroom predicted from it.
+    int64 last_forecast_timestamp_ns_;
+    float predicted_thermal_headroom_;
+
+    // Samples the thermal headroom off the game thread.
+    ADPFThermalSampler thermal_sampler_;
+    // Minimum seconds between two compute headroom calls, 0 if the platform
+    // doesn't have them. Set before the sampler starts.
+    double system_health_min_interval_;
+
+    // GameManager, API 31, and its GameState, API 33.
+    jobject obj_game_manager_;
+    jmethodID get_game_mode_;
+    jmethodID set_game_state_;
+    jobject cls_game_state_;
+    jmethodID game_state_ctor_;
+    // Game mode the profile was applied for, -1 before the first one.
+    int32 game_mode_;
+    ADPFGameModeProfile game_mode_profile_;
+
+    // ActivityManager, and the MemoryInfo and RunningAppProcessInfo reused
+    // for every sample.
+    jobject obj_activity_manager_;
+    jobject cls_activity_manager_;
+    jmethodID get_memory_info_;
+    jmethodID get_my_memory_state_;
+    jobject obj_memory_info_;
+    jobject obj_process_info_;
+    jfieldID avail_mem_field_;
+    jfieldID total_mem_field_;
+    jfieldID threshold_field_;
+    jfieldID low_memory_field_;
+    jfieldID last_trim_level_field_;
+    // Applied memory pressure level, the quality cap for it, and Clock()
+    // since the sampled level has been lower, -1 if it isn't.
+    int32 memory_pressure_;
+    int32 memory_quality_cap_;
+    int64 memory_pressure_lower_since_;
+    // Trim level sampled when the app came back to the foreground. It is
+    // left from the background and ignored until it changes, -1 if none.
+    int32 stale_trim_level_;
+    // r.Streaming.PoolSize and its priority before the memory pressure
+    // scaled it, -1 while it's untouched.
+    int32 base_streaming_pool_size_;
+    uint32 base_streaming_pool_priority_;
+
     static const int32_t max_quality_count = 4;
     Scalability::FQualityLevels quality_levels[max_quality_count];
     int32_t current_quality_level;
     int32_t target_quality_level;
+    // Hysteresis and dwell time between quality level changes.
+    ADPFQualityGovernor quality_governor_;
+    // Steps the scalability groups towards quality_levels[current_quality_level].
+    ADPFQualityLadder quality_ladder_;
+
+    // Learned headroom response of each quality level, the timestamp of the
+    // last sample it got, and the clock the planned session ends at, -1
+    // until the first plan.
+    ADPFThermalModel thermal_model_;
+    bool thermal_model_loaded_;
+    int64 last_model_sample_timestamp_ns_;
+    int64 plan_end_clock_;
+
+    // Built-in policies, the registered ones, and the one
+    // r.AndroidPerformancePolicy selects, null for the built-in policy.
+    ADPFThresholdPolicy threshold_policy_;
+    ADPFListenerPolicy listener_policy_;
+    ADPFPredictivePolicy predictive_policy_;
+    ADPFPlannedPolicy planned_policy_;
+    TMap<FName, TSharedRef<IAndroidPerformancePolicy>> registered_policies_;
+    TSharedPtr<IAndroidPerformancePolicy> custom_policy_;
+    bool policy_selection_dirty_;
+    // Overrides of the last decision, INDEX_NONE or 0 where the policy left
+    // the controllers in charge.
+    int32 policy_frame_rate_cap_;
+    float policy_screen_percentage_;
+    float policy_target_scale_;
 
     float prev_max_fps;
-    jlong prev_max_fps_nano;
+    // Applied thermal max FPS cap, 0 if none, and the game's own max FPS
+    // to restore when the cap is lifted.
+    int32 frame_rate_cap_;
+    float game_max_fps_;
+    // Target work duration of the whole frame and of each primary thread,
+    // written by the game thread and read by the reporting threads.
+    std::atomic<int64> target_work_duration_ns_;
+    std::atomic<int64> thread_target_work_duration_ns_[static_cast<int32>(EPerfHintThread::Count)] = {};
+    // Present interval, before the missed deadline scale and a workload
+    // boost.
+    int64 base_target_work_duration_ns_;
+    ADPFTargetController target_controller_;
+    // Clock() when the target tightening fallback ends, 0 if inactive.
+    int64 workload_boost_end_clock_;
+
+    // Latest measured work duration of each primary thread.
+    std::atomic<int64> last_work_duration_ns_[static_cast<int32>(EPerfHintThread::Count)] = {};
+
+    // Continuous screen percentage control.
+    ADPFResolutionController resolution_controller_;
+
+    // Frame timers, each only used by its own thread.
+    WorkDurationTimer game_frame_timer_;
+    WorkDurationTimer render_frame_timer_;
+    WorkDurationTimer rhi_frame_timer_;
+
+    // Startup boost, Clock() when it started and whether the first map has
+    // finished loading.
+    ADPFStartupBoost startup_boost_;
+    int64 startup_boost_start_clock_;
+    bool startup_boost_map_loaded_;
+
+    // GFrameCounter of the last Monitor() call.
+    uint64 last_monitor_frame_;
+
+    // Frame times for each AThermalStatus, from ATHERMAL_STATUS_NONE to
+    // ATHERMAL_STATUS_SHUTDOWN, and quality level. The interval histogram
+    // is reset with each headroom log.
+    static constexpr int32 kFrameHistogramThermalStatusCount = 7;
+    ADPFFrameHistogram frame_histograms_[kFrameHistogramThermalStatusCount][max_quality_count];
+    ADPFFrameHistogram interval_frame_histogram_;
+
+    // Published performance budget, and the values last broadcast.
+    std::atomic<float> performance_budget_;
+    float broadcast_budget_;
+    int32 broadcast_quality_level_;
+    FOnBudgetChanged on_budget_changed_;
+
+    // Clock of the current UpdateGovernor() call.
+    int64 monitor_clock_;
+    // Quality level changes since startup or the start of a replay.
+    uint32 quality_change_count_;
+    // Cost counters at the last RecordCost(), and the frames it recorded.
+    int64 last_monitor_cost_ns_;
+    int64 last_total_cost_ns_;
+    uint64 cost_frame_count_;
+
+    // Thermal trace recording, and the last recorded thermal state and
+    // frame interval.
+    ADPFThermalTraceRecorder thermal_trace_recorder_;
+    int64 last_recorded_thermal_timestamp_ns_;
+    int32 last_recorded_thermal_status_;
+    int64 last_recorded_frame_interval_ns_;
+
+    // Live governor state put aside during a replay, restored after it. The
+    // engine settings don't change during a replay, so they still match it.
+    struct ReplaySavedState {
+        int32 thermal_status = 0;
+        float thermal_headroom = 0.f;
+        int32 game_mode = 0;
+        ADPFGameModeProfile game_mode_profile;
+        int32 memory_pressure = 0;
+        int32 memory_quality_cap = 0;
+        int32 current_quality_level = 0;
+        int32 target_quality_level = 0;
+        ADPFQualityGovernor quality_governor = ADPFQualityGovernor(1);
+        ADPFQualityLadder quality_ladder;
+        int64 base_target_work_duration_ns = 0;
+        ADPFTargetController target_controller;
+        ADPFResolutionController resolution_controller;
+    };
+
+    // Thermal trace replay, its clock, and whether the sampler thread was
+    // stopped for it.
+    ADPFThermalTraceReader thermal_trace_reader_;
+    int64 replay_clock_;
+    uint32 replay_frame_count_;
+    bool replay_stopped_sampler_;
+    ADPFThermalSnapshot replay_saved_snapshot_;
+    ReplaySavedState replay_saved_state_;
 
     // for debug
     float fps_total;
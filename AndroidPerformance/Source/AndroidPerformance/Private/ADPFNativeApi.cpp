@@ -0,0 +1,88 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFNativeApi.h"
+#include "AndroidPerformanceLog.h"
+
+#if PLATFORM_ANDROID
+#include <dlfcn.h>
+#endif
+
+#if PLATFORM_ANDROID
+template <typename T>
+static void ResolveSymbol(void* lib, const char* name, T& out) {
+    out = reinterpret_cast<T>(dlsym(lib, name));
+}
+#endif
+
+ADPFNativeApi::ADPFNativeApi()
+        : get_manager(nullptr),
+            create_session(nullptr),
+            get_preferred_update_rate_nanos(nullptr),
+            update_target_work_duration(nullptr),
+            report_actual_work_duration(nullptr),
+            close_session(nullptr),
+            set_threads(nullptr),
+            work_duration_create(nullptr),
+            work_duration_release(nullptr),
+            work_duration_set_work_period_start_timestamp_nanos(nullptr),
+            work_duration_set_actual_total_duration_nanos(nullptr),
+            work_duration_set_actual_cpu_duration_nanos(nullptr),
+            work_duration_set_actual_gpu_duration_nanos(nullptr),
+            report_actual_work_duration2(nullptr),
+            set_prefer_power_efficiency(nullptr),
+            notify_workload_increase(nullptr),
+            notify_workload_spike(nullptr),
+            notify_workload_reset(nullptr),
+            get_cpu_headroom(nullptr),
+            get_gpu_headroom(nullptr),
+            get_cpu_headroom_min_interval_millis(nullptr),
+            get_gpu_headroom_min_interval_millis(nullptr),
+            native_window_set_frame_rate(nullptr) {
+#if PLATFORM_ANDROID
+    // libandroid.so is always loaded in the app process, dlopen only takes
+    // another reference to it. The handle is never closed.
+    void* lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (lib == nullptr) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to open libandroid.so."));
+        return;
+    }
+
+    ResolveSymbol(lib, "APerformanceHint_getManager", get_manager);
+    ResolveSymbol(lib, "APerformanceHint_createSession", create_session);
+    ResolveSymbol(lib, "APerformanceHint_getPreferredUpdateRateNanos", get_preferred_update_rate_nanos);
+    ResolveSymbol(lib, "APerformanceHint_updateTargetWorkDuration", update_target_work_duration);
+    ResolveSymbol(lib, "APerformanceHint_reportActualWorkDuration", report_actual_work_duration);
+    ResolveSymbol(lib, "APerformanceHint_closeSession", close_session);
+    ResolveSymbol(lib, "APerformanceHint_setThreads", set_threads);
+    ResolveSymbol(lib, "AWorkDuration_create", work_duration_create);
+    ResolveSymbol(lib, "AWorkDuration_release", work_duration_release);
+    ResolveSymbol(lib, "AWorkDuration_setWorkPeriodStartTimestampNanos", work_duration_set_work_period_start_timestamp_nanos);
+    ResolveSymbol(lib, "AWorkDuration_setActualTotalDurationNanos", work_duration_set_actual_total_duration_nanos);
+    ResolveSymbol(lib, "AWorkDuration_setActualCpuDurationNanos", work_duration_set_actual_cpu_duration_nanos);
+    ResolveSymbol(lib, "AWorkDuration_setActualGpuDurationNanos", work_duration_set_actual_gpu_duration_nanos);
+    ResolveSymbol(lib, "APerformanceHint_reportActualWorkDuration2", report_actual_work_duration2);
+    ResolveSymbol(lib, "APerformanceHint_setPreferPowerEfficiency", set_prefer_power_efficiency);
+    ResolveSymbol(lib, "APerformanceHint_notifyWorkloadIncrease", notify_workload_increase);
+    ResolveSymbol(lib, "APerformanceHint_notifyWorkloadSpike", notify_workload_spike);
+    ResolveSymbol(lib, "APerformanceHint_notifyWorkloadReset", notify_workload_reset);
+    ResolveSymbol(lib, "ASystemHealth_getCpuHeadroom", get_cpu_headroom);
+    ResolveSymbol(lib, "ASystemHealth_getGpuHeadroom", get_gpu_headroom);
+    ResolveSymbol(lib, "ASystemHealth_getCpuHeadroomMinIntervalMillis", get_cpu_headroom_min_interval_millis);
+    ResolveSymbol(lib, "ASystemHealth_getGpuHeadroomMinIntervalMillis", get_gpu_headroom_min_interval_millis);
+    ResolveSymbol(lib, "ANativeWindow_setFrameRate", native_window_set_frame_rate);
+#endif
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_NATIVE_API_H_
+#define ADPF_NATIVE_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Opaque NDK types. They are declared here instead of including
+// <android/performance_hint.h>, because the plugin is built against an NDK API
+// level lower than the one that introduced the functions.
+struct APerformanceHintManager;
+struct APerformanceHintSession;
+struct ANativeWindow;
+struct AWorkDuration;
+struct ACpuHeadroomParams;
+struct AGpuHeadroomParams;
+
+/*
+ * ADPFNativeApi resolves the NDK performance hint functions from libandroid.so
+ * at runtime. A function pointer is nullptr when the running platform does not
+ * provide it.
+ */
+struct ADPFNativeApi {
+    // Singleton function. The symbols are resolved on the first call.
+    static const ADPFNativeApi& Get() {
+        static const ADPFNativeApi instance;
+        return instance;
+    }
+
+    // True when the API 33 performance hint functions are all available.
+    bool IsPerformanceHintAvailable() const {
+        return get_manager != nullptr && create_session != nullptr &&
+                get_preferred_update_rate_nanos != nullptr &&
+                update_target_work_duration != nullptr &&
+                report_actual_work_duration != nullptr && close_session != nullptr;
+    }
+
+    // API 33.
+    APerformanceHintManager* (*get_manager)();
+    APerformanceHintSession* (*create_session)(APerformanceHintManager* manager,
+            const int32_t* thread_ids, size_t size, int64_t initial_target_work_duration_nanos);
+    int64_t (*get_preferred_update_rate_nanos)(APerformanceHintManager* manager);
+    int (*update_target_work_duration)(APerformanceHintSession* session, int64_t target_duration_nanos);
+    int (*report_actual_work_duration)(APerformanceHintSession* session, int64_t actual_duration_nanos);
+    void (*close_session)(APerformanceHintSession* session);
+
+    // API 34.
+    int (*set_threads)(APerformanceHintSession* session, const int32_t* thread_ids, size_t size);
+
+    // API 35.
+    AWorkDuration* (*work_duration_create)();
+    void (*work_duration_release)(AWorkDuration* work_duration);
+    void (*work_duration_set_work_period_start_timestamp_nanos)(AWorkDuration* work_duration, int64_t timestamp_nanos);
+    void (*work_duration_set_actual_total_duration_nanos)(AWorkDuration* work_duration, int64_t duration_nanos);
+    void (*work_duration_set_actual_cpu_duration_nanos)(AWorkDuration* work_duration, int64_t duration_nanos);
+    void (*work_duration_set_actual_gpu_duration_nanos)(AWorkDuration* work_duration, int64_t duration_nanos);
+    int (*report_actual_work_duration2)(APerformanceHintSession* session, AWorkDuration* work_duration);
+
+    int (*set_prefer_power_efficiency)(APerformanceHintSession* session, bool enabled);
+
+    // True when the API 35 AWorkDuration functions are all available.
+    bool IsWorkDurationAvailable() const {
+        return work_duration_create != nullptr && work_duration_release != nullptr &&
+                work_duration_set_work_period_start_timestamp_nanos != nullptr &&
+                work_duration_set_actual_total_duration_nanos != nullptr &&
+                work_duration_set_actual_cpu_duration_nanos != nullptr &&
+                work_duration_set_actual_gpu_duration_nanos != nullptr &&
+                report_actual_work_duration2 != nullptr;
+    }
+
+    // API 36. Hints about work that is about to change, before the reported
+    // durations show it.
+    int (*notify_workload_increase)(APerformanceHintSession* session, bool cpu, bool gpu, const char* debug_name);
+    int (*notify_workload_spike)(APerformanceHintSession* session, bool cpu, bool gpu, const char* debug_name);
+    int (*notify_workload_reset)(APerformanceHintSession* session, bool cpu, bool gpu, const char* debug_name);
+
+    // True when the API 36 workload hint functions are all available.
+    bool IsWorkloadHintAvailable() const {
+        return notify_workload_increase != nullptr && notify_workload_spike != nullptr &&
+                notify_workload_reset != nullptr;
+    }
+
+    // API 36. Compute headroom from 0 to 100, nullptr params use the
+    // platform defaults.
+    int (*get_cpu_headroom)(const ACpuHeadroomParams* params, float* out_headroom);
+    int (*get_gpu_headroom)(const AGpuHeadroomParams* params, float* out_headroom);
+    int (*get_cpu_headroom_min_interval_millis)(int64_t* out_millis);
+    int (*get_gpu_headroom_min_interval_millis)(int64_t* out_millis);
+
+    // True when the API 36 headroom functions are all available.
+    bool IsSystemHealthAvailable() const {
+        return get_cpu_headroom != nullptr && get_gpu_headroom != nullptr &&
+                get_cpu_headroom_min_interval_millis != nullptr &&
+                get_gpu_headroom_min_interval_millis != nullptr;
+    }
+
+    // ANativeWindow_setFrameRate, API 30.
+    int32_t (*native_window_set_frame_rate)(ANativeWindow* window, float frame_rate, int8_t compatibility);
+
+ private:
+    ADPFNativeApi();
+};
+
+#endif    // ADPF_NATIVE_API_H_
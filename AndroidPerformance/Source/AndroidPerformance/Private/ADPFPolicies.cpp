@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFPolicies.h"
+#include "ADPFQualityGovernor.h"
+#include "ADPFThermalModel.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarAndroidPerformancePlanHeadroomLimit(
+    TEXT("r.AndroidPerformancePlanHeadroomLimit"),
+    0.95f,
+    TEXT("Highest thermal headroom the planned quality mode lets the model predict before the session ends."),
+    ECVF_RenderThreadSafe);
+
+void ADPFThresholdPolicy::Decide(const FAndroidPerformancePolicyInput& input,
+        FAndroidPerformancePolicyDecision& decision) const {
+    if (input.bUpdateDue) {
+        decision.QualityLevel = governor_.LevelForHeadroom(input.ThermalHeadroom, input.QualityLevel);
+    }
+}
+
+void ADPFListenerPolicy::Decide(const FAndroidPerformancePolicyInput& input,
+        FAndroidPerformancePolicyDecision& decision) const {
+    if (input.bUpdateDue) {
+        decision.QualityLevel = FMath::Clamp(input.QualityLevelCount - input.ThermalStatus - 1,
+                0, input.QualityLevelCount - 1);
+    }
+}
+
+void ADPFPredictivePolicy::Decide(const FAndroidPerformancePolicyInput& input,
+        FAndroidPerformancePolicyDecision& decision) const {
+    if (input.bUpdateDue) {
+        decision.QualityLevel = governor_.LevelForHeadroom(input.PredictedHeadroom, input.QualityLevel);
+    } else if (input.bNewThermalSample &&
+            governor_.LevelForHeadroom(input.PredictedHeadroom, input.QualityLevel) < input.QualityLevel) {
+        decision.QualityLevel = input.QualityLevel - 1;
+    }
+}
+
+void ADPFPlannedPolicy::Decide(const FAndroidPerformancePolicyInput& input,
+        FAndroidPerformancePolicyDecision& decision) const {
+    if (!input.bUpdateDue) {
+        return;
+    }
+    const int32 threshold_level = governor_.LevelForHeadroom(input.ThermalHeadroom, input.QualityLevel);
+    const float horizon = FMath::Max(input.RemainingSessionSeconds, kMinPlanHorizonSeconds);
+    const float limit = CVarAndroidPerformancePlanHeadroomLimit.GetValueOnGameThread();
+    for (int32 level = input.QualityLevelCount - 1; level > 0; --level) {
+        if (!model_.CanPredict(level)) {
+            if (level <= threshold_level) {
+                decision.QualityLevel = level;
+                return;
+            }
+            continue;
+        }
+        if (model_.PredictPeakHeadroom(level, input.ThermalHeadroom, horizon) < limit) {
+            decision.QualityLevel = level;
+            return;
+        }
+    }
+    decision.QualityLevel = 0;
+}
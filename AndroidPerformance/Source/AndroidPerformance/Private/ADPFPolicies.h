@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_POLICIES_H_
+#define ADPF_POLICIES_H_
+
+#include "CoreMinimal.h"
+#include "AndroidPerformancePolicy.h"
+
+class ADPFQualityGovernor;
+class ADPFThermalModel;
+
+// Shortest remaining session the planned policy plans for, once the
+// expected end has passed.
+static constexpr float kMinPlanHorizonSeconds = 60.0f;
+
+// Built-in policies of r.AndroidPerformanceChangeQualities. The manager owns
+// one of each and calls the selected one by its concrete type, so the per
+// frame path has no virtual call. They only propose quality levels and leave
+// the FPS cap, resolution and hint targets to their controllers.
+
+// 1: headroom thresholds, at each periodic update. With the default
+// thresholds, the headroom maps to:
+// x < 0.75 -> 3, 0.75 < x < 0.85 -> 2, 0.85 < x < 0.95 -> 1, 0.95 < x -> 0
+// Raising the level again needs the headroom to fall below the lower up
+// thresholds.
+class ADPFThresholdPolicy {
+ public:
+    explicit ADPFThresholdPolicy(const ADPFQualityGovernor& governor) : governor_(governor) {}
+    void Decide(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision) const;
+
+ private:
+    const ADPFQualityGovernor& governor_;
+};
+
+// 2: one level per thermal status from the listener, at each periodic
+// update.
+class ADPFListenerPolicy {
+ public:
+    void Decide(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision) const;
+};
+
+// 3: headroom thresholds on the forecast headroom. A new forecast that
+// crosses a threshold steps down right away instead of waiting for the next
+// update.
+class ADPFPredictivePolicy {
+ public:
+    explicit ADPFPredictivePolicy(const ADPFQualityGovernor& governor) : governor_(governor) {}
+    void Decide(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision) const;
+
+ private:
+    const ADPFQualityGovernor& governor_;
+};
+
+// 4: highest level whose predicted headroom stays below the limit until the
+// expected session ends. A level without enough observations yet is only
+// picked if the headroom thresholds allow it.
+class ADPFPlannedPolicy {
+ public:
+    ADPFPlannedPolicy(const ADPFQualityGovernor& governor, const ADPFThermalModel& model)
+            : governor_(governor),
+                model_(model) {}
+    void Decide(const FAndroidPerformancePolicyInput& input, FAndroidPerformancePolicyDecision& decision) const;
+
+ private:
+    const ADPFQualityGovernor& governor_;
+    const ADPFThermalModel& model_;
+};
+
+#endif    // ADPF_POLICIES_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFQualityGovernor.h"
+#include "ADPFCVarList.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceQualityDownThresholds(
+    TEXT("r.AndroidPerformanceQualityDownThresholds"),
+    TEXT("0.75,0.85,0.95"),
+    TEXT("Comma separated thermal headroom thresholds, from the highest quality level boundary to the lowest.\n")
+    TEXT("Quality is lowered below a boundary when the headroom reaches its threshold."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceQualityDownThresholds(CVarAndroidPerformanceQualityDownThresholds);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceQualityUpThresholds(
+    TEXT("r.AndroidPerformanceQualityUpThresholds"),
+    TEXT("0.70,0.80,0.90"),
+    TEXT("Comma separated thermal headroom thresholds, from the highest quality level boundary to the lowest.\n")
+    TEXT("Quality is raised above a boundary only when the headroom is below its threshold."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceQualityUpThresholds(CVarAndroidPerformanceQualityUpThresholds);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceQualityMinDwell(
+    TEXT("r.AndroidPerformanceQualityMinDwell"),
+    30.0f,
+    TEXT("Minimum time in seconds a quality level is kept before it changes again.\n")
+    TEXT("Severe thermal throttling lowers the quality regardless."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceQualityCooldownConfirm(
+    TEXT("r.AndroidPerformanceQualityCooldownConfirm"),
+    45.0f,
+    TEXT("Time in seconds a higher quality level must be proposed continuously before quality is raised."),
+    ECVF_RenderThreadSafe);
+
+ADPFQualityGovernor::ADPFQualityGovernor(int32 level_count)
+        : level_count_(level_count),
+            last_change_time_(-DBL_MAX),
+            pending_up_level_(-1),
+            pending_up_since_(0.0) {
+}
+
+void ADPFQualityGovernor::ReadThresholds(int32 boundary, float& out_down, float& out_up) const {
+    out_down = ListAndroidPerformanceQualityDownThresholds.Get(boundary, 0.f);
+    out_up = ListAndroidPerformanceQualityUpThresholds.Get(boundary, 0.f);
+
+    // Every boundary needs both thresholds, and raising must never be easier
+    // than lowering.
+    if (out_down <= 0.f) {
+        out_down = 1.f;
+    }
+    if (out_up <= 0.f || out_up > out_down) {
+        out_up = out_down;
+    }
+}
+
+int32 ADPFQualityGovernor::LevelForHeadroom(float head_room, int32 current_level) const {
+    // Threshold i is the boundary between level (level_count_ - 1 - i) and
+    // the level below it.
+    int32 down_level = level_count_ - 1;
+    int32 up_level = level_count_ - 1;
+    for (int32 i = 0; i < level_count_ - 1; ++i) {
+        float down = 0.f;
+        float up = 0.f;
+        ReadThresholds(i, down, up);
+        if (head_room >= down) {
+            down_level = level_count_ - 2 - i;
+        }
+        if (head_room >= up) {
+            up_level = level_count_ - 2 - i;
+        }
+    }
+
+    if (down_level < current_level) {
+        return down_level;
+    }
+    if (up_level > current_level) {
+        return up_level;
+    }
+    return current_level;
+}
+
+int32 ADPFQualityGovernor::Update(int32 current_level, int32 proposed_level, double now, bool emergency) {
+    proposed_level = FMath::Clamp(proposed_level, 0, level_count_ - 1);
+
+    if (proposed_level <= current_level) {
+        // Any proposal that isn't higher restarts the cool-down confirmation.
+        pending_up_level_ = -1;
+    }
+
+    const bool dwell_elapsed = now - last_change_time_ >= CVarAndroidPerformanceQualityMinDwell.GetValueOnAnyThread();
+
+    if (proposed_level < current_level) {
+        if (dwell_elapsed || emergency) {
+            return proposed_level;
+        }
+        return current_level;
+    }
+
+    if (proposed_level > current_level) {
+        if (pending_up_level_ < 0) {
+            pending_up_since_ = now;
+        }
+        pending_up_level_ = proposed_level;
+
+        const bool confirmed = now - pending_up_since_ >= CVarAndroidPerformanceQualityCooldownConfirm.GetValueOnAnyThread();
+        if (confirmed && dwell_elapsed) {
+            // Raise one level at a time, the next level needs a new confirmation.
+            pending_up_level_ = -1;
+            return current_level + 1;
+        }
+    }
+    return current_level;
+}
+
+void ADPFQualityGovernor::OnLevelApplied(double now) {
+    last_change_time_ = now;
+    pending_up_level_ = -1;
+}
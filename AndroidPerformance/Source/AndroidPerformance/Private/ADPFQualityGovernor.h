@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_QUALITY_GOVERNOR_H_
+#define ADPF_QUALITY_GOVERNOR_H_
+
+#include "CoreMinimal.h"
+
+/*
+ * ADPFQualityGovernor decides when the quality level actually changes, so
+ * that a headroom hovering around a threshold doesn't flip the level on
+ * every update.
+ *
+ * - Lowering quality uses the down thresholds, raising it the lower up
+ *   thresholds.
+ * - A level is kept for a minimum dwell time, unless the device is severely
+ *   throttled.
+ * - Quality is raised one level at a time, and only after the higher level
+ *   was proposed continuously for the cool-down confirmation time.
+ */
+class ADPFQualityGovernor {
+ public:
+    explicit ADPFQualityGovernor(int32 level_count);
+
+    // Map a thermal headroom to a level with hysteresis around the current one.
+    int32 LevelForHeadroom(float head_room, int32 current_level) const;
+
+    // Returns the level to apply now, which is current_level if it must not
+    // change yet. now is in seconds.
+    int32 Update(int32 current_level, int32 proposed_level, double now, bool emergency);
+
+    // Must be called when a level is applied.
+    void OnLevelApplied(double now);
+
+ private:
+    // Thresholds of a level boundary, ordered from the highest level boundary
+    // to the lowest.
+    void ReadThresholds(int32 boundary, float& out_down, float& out_up) const;
+
+    int32 level_count_;
+    double last_change_time_;
+    // Higher level waiting for cool-down confirmation, -1 if none.
+    int32 pending_up_level_;
+    double pending_up_since_;
+};
+
+#endif    // ADPF_QUALITY_GOVERNOR_H_
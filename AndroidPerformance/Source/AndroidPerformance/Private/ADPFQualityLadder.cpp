@@ -0,0 +1,216 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFQualityLadder.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/IConsoleManager.h"
+#include "Algo/Reverse.h"
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceQualityStepFrames(
+    TEXT("r.AndroidPerformanceQualityStepFrames"),
+    10,
+    TEXT("Frames between two scalability group changes while moving to a new quality level.\n")
+    TEXT(" 0: every group changes in the same frame"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceQualityStepOrder(
+    TEXT("r.AndroidPerformanceQualityStepOrder"),
+    TEXT("Shadow,Effects,PostProcess,Foliage,Shading,AntiAliasing,ViewDistance,Resolution,Texture"),
+    TEXT("Order in which the scalability groups are lowered, cheapest change with the biggest saving first.\n")
+    TEXT("Quality is raised in the reverse order. Groups missing from the list are changed last."),
+    ECVF_RenderThreadSafe);
+
+static const TCHAR* const kQualityGroupNames[] = {
+    TEXT("Resolution"),
+    TEXT("ViewDistance"),
+    TEXT("AntiAliasing"),
+    TEXT("Shadow"),
+    TEXT("PostProcess"),
+    TEXT("Texture"),
+    TEXT("Effects"),
+    TEXT("Foliage"),
+    TEXT("Shading"),
+};
+static_assert(UE_ARRAY_COUNT(kQualityGroupNames) == static_cast<int32>(EADPFQualityGroup::Count),
+        "Every quality group needs a name");
+
+// Resource each group mostly costs. View distance and foliage add draw calls
+// on the CPU side, the others are mostly GPU work.
+static EADPFBottleneck GetQualityGroupResource(EADPFQualityGroup group) {
+    switch (group) {
+        case EADPFQualityGroup::ViewDistance:
+        case EADPFQualityGroup::Foliage:
+            return EADPFBottleneck::CPU;
+        default:
+            return EADPFBottleneck::GPU;
+    }
+}
+
+// Copy one group from source to levels. Returns false if it already matched.
+static bool CopyQualityGroup(EADPFQualityGroup group, const Scalability::FQualityLevels& source,
+        Scalability::FQualityLevels& levels) {
+    auto Copy = [](auto& to, const auto& from) {
+        if (to == from) {
+            return false;
+        }
+        to = from;
+        return true;
+    };
+
+    switch (group) {
+        case EADPFQualityGroup::Resolution:
+            return Copy(levels.ResolutionQuality, source.ResolutionQuality);
+        case EADPFQualityGroup::ViewDistance:
+            return Copy(levels.ViewDistanceQuality, source.ViewDistanceQuality);
+        case EADPFQualityGroup::AntiAliasing:
+            return Copy(levels.AntiAliasingQuality, source.AntiAliasingQuality);
+        case EADPFQualityGroup::Shadow:
+            return Copy(levels.ShadowQuality, source.ShadowQuality);
+        case EADPFQualityGroup::PostProcess:
+            return Copy(levels.PostProcessQuality, source.PostProcessQuality);
+        case EADPFQualityGroup::Texture:
+            return Copy(levels.TextureQuality, source.TextureQuality);
+        case EADPFQualityGroup::Effects:
+            return Copy(levels.EffectsQuality, source.EffectsQuality);
+        case EADPFQualityGroup::Foliage:
+            return Copy(levels.FoliageQuality, source.FoliageQuality);
+        case EADPFQualityGroup::Shading:
+            return Copy(levels.ShadingQuality, source.ShadingQuality);
+        default:
+            return false;
+    }
+}
+
+ADPFQualityLadder::ADPFQualityLadder()
+        : dry_run_(false),
+            frames_since_step_(0),
+            settled_(true) {
+}
+
+void ADPFQualityLadder::StartDryRun(const Scalability::FQualityLevels& levels) {
+    dry_run_ = true;
+    dry_run_levels_ = levels;
+    settled_ = true;
+}
+
+Scalability::FQualityLevels ADPFQualityLadder::GetQualityLevels() const {
+    return dry_run_ ? dry_run_levels_ : Scalability::GetQualityLevels();
+}
+
+void ADPFQualityLadder::ApplyQualityLevels(const Scalability::FQualityLevels& levels, bool force) {
+    if (dry_run_) {
+        dry_run_levels_ = levels;
+    } else {
+        SetQualityLevels(levels, force);
+    }
+}
+
+void ADPFQualityLadder::ParseStepOrder() {
+    order_.Reset();
+
+    TArray<FString> names;
+    CVarAndroidPerformanceQualityStepOrder.GetValueOnGameThread().ParseIntoArray(names, TEXT(","));
+    for (FString& name : names) {
+        name.TrimStartAndEndInline();
+        for (int32 i = 0; i < static_cast<int32>(EADPFQualityGroup::Count); ++i) {
+            if (name.Equals(kQualityGroupNames[i], ESearchCase::IgnoreCase)) {
+                order_.AddUnique(static_cast<EADPFQualityGroup>(i));
+                break;
+            }
+        }
+    }
+    for (int32 i = 0; i < static_cast<int32>(EADPFQualityGroup::Count); ++i) {
+        order_.AddUnique(static_cast<EADPFQualityGroup>(i));
+    }
+}
+
+// Whether lowering the group saves the short resource. Textures and shadow
+// maps hold most of the memory of the groups.
+static bool SavesResource(EADPFQualityGroup group, EADPFBottleneck bottleneck) {
+    if (bottleneck == EADPFBottleneck::Memory) {
+        return group == EADPFQualityGroup::Texture || group == EADPFQualityGroup::Shadow;
+    }
+    return GetQualityGroupResource(group) == bottleneck;
+}
+
+void ADPFQualityLadder::MoveBottleneckGroupsFirst(EADPFBottleneck bottleneck) {
+    TArray<EADPFQualityGroup> others;
+    int32 next = 0;
+    for (EADPFQualityGroup group : order_) {
+        if (SavesResource(group, bottleneck)) {
+            order_[next++] = group;
+        } else {
+            others.Add(group);
+        }
+    }
+    for (EADPFQualityGroup group : others) {
+        order_[next++] = group;
+    }
+}
+
+void ADPFQualityLadder::SetTarget(const Scalability::FQualityLevels& target, bool lowering,
+        EADPFBottleneck bottleneck) {
+    target_ = target;
+    ParseStepOrder();
+    if (!lowering) {
+        Algo::Reverse(order_);
+    } else if (bottleneck != EADPFBottleneck::None) {
+        MoveBottleneckGroupsFirst(bottleneck);
+    }
+    settled_ = false;
+    // The first step is applied right away.
+    frames_since_step_ = INT32_MAX;
+}
+
+bool ADPFQualityLadder::Tick() {
+    if (settled_) {
+        return false;
+    }
+
+    const int32 step_frames = CVarAndroidPerformanceQualityStepFrames.GetValueOnGameThread();
+    if (step_frames <= 0) {
+        ApplyQualityLevels(target_, true);
+        settled_ = true;
+        return true;
+    }
+
+    if (frames_since_step_ < step_frames) {
+        frames_since_step_++;
+        return false;
+    }
+
+    // Start from the current settings, so a change made elsewhere in the
+    // meantime isn't overwritten by a stale copy.
+    Scalability::FQualityLevels levels = GetQualityLevels();
+    for (EADPFQualityGroup group : order_) {
+        if (CopyQualityGroup(group, target_, levels)) {
+            UE_LOG(LogAndroidPerformance, Log, TEXT("Change %s quality"), kQualityGroupNames[static_cast<int32>(group)]);
+            // Only the changed group differs from the current settings, so
+            // only that group is applied.
+            ApplyQualityLevels(levels, false);
+            frames_since_step_ = 0;
+            return true;
+        }
+    }
+
+    // Every stepped group matches. Apply the anchor once more for the groups
+    // the ladder doesn't step through.
+    if (!(levels == target_)) {
+        ApplyQualityLevels(target_, false);
+    }
+    settled_ = true;
+    return true;
+}
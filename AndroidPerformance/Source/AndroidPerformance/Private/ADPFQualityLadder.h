@@ -0,0 +1,91 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_QUALITY_LADDER_H_
+#define ADPF_QUALITY_LADDER_H_
+
+#include "CoreMinimal.h"
+#include "Scalability.h"
+
+// Scalability groups the ladder steps through.
+enum class EADPFQualityGroup : uint8 {
+    Resolution,
+    ViewDistance,
+    AntiAliasing,
+    Shadow,
+    PostProcess,
+    Texture,
+    Effects,
+    Foliage,
+    Shading,
+    Count,
+};
+
+// Resource that is short, from the CPU and GPU headroom or the memory
+// pressure.
+enum class EADPFBottleneck : uint8 {
+    None,
+    CPU,
+    GPU,
+    Memory,
+};
+
+/*
+ * ADPFQualityLadder moves the scalability settings towards a quality level
+ * one scalability group at a time, spread over several frames, instead of
+ * changing every group in the same frame. The quality levels are the
+ * anchor points of the ladder.
+ */
+class ADPFQualityLadder {
+ public:
+    ADPFQualityLadder();
+
+    // Start moving towards the target. Lowering quality steps through the
+    // groups in r.AndroidPerformanceQualityStepOrder, raising it in reverse.
+    // When lowering with a known bottleneck, the groups that cost that
+    // resource are stepped first. Texture and shadow quality free the most
+    // memory.
+    void SetTarget(const Scalability::FQualityLevels& target, bool lowering,
+            EADPFBottleneck bottleneck = EADPFBottleneck::None);
+
+    // Call once a frame. Applies at most one group change when a step is due,
+    // and returns true if it did.
+    bool Tick();
+
+    bool IsSettled() const { return settled_; }
+
+    // Send the steps to a copy of the settings that starts at levels, instead
+    // of the engine, for as long as this ladder is used. Used by the
+    // thermal trace replays.
+    void StartDryRun(const Scalability::FQualityLevels& levels);
+
+    // Current settings, the dry-run copy in dry-run mode.
+    Scalability::FQualityLevels GetQualityLevels() const;
+
+ private:
+    void ParseStepOrder();
+    void MoveBottleneckGroupsFirst(EADPFBottleneck bottleneck);
+    void ApplyQualityLevels(const Scalability::FQualityLevels& levels, bool force);
+
+    Scalability::FQualityLevels target_;
+    Scalability::FQualityLevels dry_run_levels_;
+    bool dry_run_;
+    TArray<EADPFQualityGroup> order_;
+    int32 frames_since_step_;
+    bool settled_;
+};
+
+#endif    // ADPF_QUALITY_LADDER_H_
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFResolutionController.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceDynamicResolution(
+    TEXT("r.AndroidPerformanceDynamicResolution"),
+    0,
+    TEXT("Enable/disable continuous r.ScreenPercentage control from the thermal headroom and work durations.\n")
+    TEXT(" 0: off (disabled)\n")
+    TEXT(" 1: on (enabled)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceDynamicResolutionMin(
+    TEXT("r.AndroidPerformanceDynamicResolutionMin"),
+    50.0f,
+    TEXT("Lowest screen percentage the controller sets."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceDynamicResolutionMax(
+    TEXT("r.AndroidPerformanceDynamicResolutionMax"),
+    100.0f,
+    TEXT("Highest screen percentage the controller sets. The resolution quality of the current scalability level is also an upper bound."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceDynamicResolutionHeadroomStart(
+    TEXT("r.AndroidPerformanceDynamicResolutionHeadroomStart"),
+    0.7f,
+    TEXT("Thermal headroom where the highest allowed screen percentage starts to fall. It reaches the minimum at headroom 1."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceDynamicResolutionGain(
+    TEXT("r.AndroidPerformanceDynamicResolutionGain"),
+    40.0f,
+    TEXT("Screen percentage change per second for a work duration 100% over target."),
+    ECVF_RenderThreadSafe);
+
+// Work duration error within which the screen percentage is held.
+static constexpr float kDeadband = 0.05f;
+// Weight of the newest frame in the smoothed error.
+static constexpr float kErrorSmoothing = 0.1f;
+// Smallest change written to the console variable.
+static constexpr float kMinApplyDelta = 1.0f;
+
+ADPFResolutionController::ADPFResolutionController()
+        : enabled_(false),
+            dry_run_(false),
+            screen_percentage_(100.f),
+            smoothed_error_(0.f),
+            applied_screen_percentage_(0.f) {
+}
+
+void ADPFResolutionController::Tick(int64 work_duration_ns, int64 target_duration_ns, float head_room, float delta_time,
+        float resolution_quality, float override_percentage) {
+    if (override_percentage > 0.f) {
+        // Picks up from the override if the controller takes over again.
+        enabled_ = true;
+        screen_percentage_ = override_percentage;
+        smoothed_error_ = 0.f;
+        Apply(override_percentage);
+        return;
+    }
+
+    if (CVarAndroidPerformanceDynamicResolution.GetValueOnGameThread() == 0) {
+        if (enabled_) {
+            // Give the resolution back to the scalability settings.
+            enabled_ = false;
+            Apply(resolution_quality);
+        }
+        return;
+    }
+
+    const float max_percentage = FMath::Min(CVarAndroidPerformanceDynamicResolutionMax.GetValueOnGameThread(),
+            resolution_quality);
+    const float min_percentage = FMath::Min(CVarAndroidPerformanceDynamicResolutionMin.GetValueOnGameThread(), max_percentage);
+
+    if (!enabled_) {
+        // Start from the scalability resolution.
+        enabled_ = true;
+        screen_percentage_ = max_percentage;
+        smoothed_error_ = 0.f;
+        applied_screen_percentage_ = 0.f;
+    }
+
+    // Thermal ceiling, linear from the start headroom down to the minimum at 1.
+    const float head_room_start = FMath::Clamp(CVarAndroidPerformanceDynamicResolutionHeadroomStart.GetValueOnGameThread(), 0.f, 0.99f);
+    const float pressure = FMath::Clamp((head_room - head_room_start) / (1.f - head_room_start), 0.f, 1.f);
+    const float ceiling = FMath::Lerp(max_percentage, min_percentage, pressure);
+
+    // Relative work duration error, positive when over budget.
+    if (work_duration_ns > 0 && target_duration_ns > 0) {
+        const float error = static_cast<float>(work_duration_ns) / static_cast<float>(target_duration_ns) - 1.f;
+        smoothed_error_ = FMath::Lerp(smoothed_error_, error, kErrorSmoothing);
+    }
+    if (FMath::Abs(smoothed_error_) > kDeadband) {
+        const float gain = CVarAndroidPerformanceDynamicResolutionGain.GetValueOnGameThread();
+        screen_percentage_ -= gain * smoothed_error_ * delta_time;
+    }
+    screen_percentage_ = FMath::Clamp(screen_percentage_, min_percentage, ceiling);
+
+    Apply(screen_percentage_);
+}
+
+float ADPFResolutionController::ClampScreenPercentage(float screen_percentage) {
+    const float max_percentage = CVarAndroidPerformanceDynamicResolutionMax.GetValueOnGameThread();
+    const float min_percentage = FMath::Min(CVarAndroidPerformanceDynamicResolutionMin.GetValueOnGameThread(), max_percentage);
+    return FMath::Clamp(screen_percentage, min_percentage, max_percentage);
+}
+
+void ADPFResolutionController::Apply(float screen_percentage) {
+    if (dry_run_) {
+        if (FMath::Abs(screen_percentage - applied_screen_percentage_) >= kMinApplyDelta) {
+            applied_screen_percentage_ = screen_percentage;
+        }
+        return;
+    }
+
+    static IConsoleVariable* CVarScreenPercentage = IConsoleManager::Get().FindConsoleVariable(TEXT("r.ScreenPercentage"));
+    if (CVarScreenPercentage == nullptr) {
+        return;
+    }
+
+    // Compare against the live value, since applying scalability levels
+    // writes r.ScreenPercentage too.
+    if (FMath::Abs(screen_percentage - CVarScreenPercentage->GetFloat()) < kMinApplyDelta) {
+        return;
+    }
+
+    // Yield to a screen percentage set explicitly by the game or the console,
+    // a lower priority write would be ignored anyway.
+    if ((CVarScreenPercentage->GetFlags() & ECVF_SetByMask) > ECVF_SetByScalability) {
+        return;
+    }
+
+    CVarScreenPercentage->Set(screen_percentage, ECVF_SetByScalability);
+    applied_screen_percentage_ = screen_percentage;
+}
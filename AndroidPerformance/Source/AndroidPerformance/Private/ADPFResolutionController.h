@@ -0,0 +1,61 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_RESOLUTION_CONTROLLER_H_
+#define ADPF_RESOLUTION_CONTROLLER_H_
+
+#include "CoreMinimal.h"
+
+/*
+ * ADPFResolutionController adjusts r.ScreenPercentage every frame. The
+ * thermal headroom lowers the highest allowed screen percentage, and the gap
+ * between the measured and target work duration moves the screen percentage
+ * within that range. The scalability resolution quality of the current
+ * level stays the upper bound, so the level only moves when resolution
+ * can't absorb the load.
+ */
+class ADPFResolutionController {
+ public:
+    ADPFResolutionController();
+
+    // work_duration_ns is the longest work duration of the last frame, and
+    // resolution_quality the scalability resolution of the current settings.
+    // A positive override_percentage is applied as is, e.g. a policy decision.
+    void Tick(int64 work_duration_ns, int64 target_duration_ns, float head_room, float delta_time,
+            float resolution_quality, float override_percentage = 0.f);
+
+    // Keep the screen percentage to this controller instead of writing
+    // r.ScreenPercentage, for as long as it is used. Used by the thermal
+    // trace replays.
+    void StartDryRun() { dry_run_ = true; }
+
+    // Clamp to r.AndroidPerformanceDynamicResolutionMin and Max.
+    static float ClampScreenPercentage(float screen_percentage);
+
+    // Current screen percentage, 0 while the controller is disabled.
+    float GetScreenPercentage() const { return enabled_ ? screen_percentage_ : 0.f; }
+
+ private:
+    void Apply(float screen_percentage);
+
+    bool enabled_;
+    bool dry_run_;
+    float screen_percentage_;
+    float smoothed_error_;
+    float applied_screen_percentage_;
+};
+
+#endif    // ADPF_RESOLUTION_CONTROLLER_H_
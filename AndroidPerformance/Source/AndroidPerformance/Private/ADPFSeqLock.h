@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_SEQ_LOCK_H_
+#define ADPF_SEQ_LOCK_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+/*
+ * ADPFSeqLock publishes a trivially copyable value from one writer thread to
+ * any number of readers. Readers never block the writer, and retry only if
+ * they raced with a write.
+ */
+template <typename T>
+class ADPFSeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "ADPFSeqLock needs a trivially copyable type");
+
+ public:
+    ADPFSeqLock() : sequence_(0), value_() {}
+
+    // Only one thread may write.
+    void Store(const T& value) {
+        const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value_ = value;
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    T Load() const {
+        T value;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequence_.load(std::memory_order_acquire);
+            value = value_;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence_.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+        return value;
+    }
+
+ private:
+    std::atomic<uint32_t> sequence_;
+    T value_;
+};
+
+#endif    // ADPF_SEQ_LOCK_H_
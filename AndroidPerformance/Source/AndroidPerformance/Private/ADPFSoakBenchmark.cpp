@@ -0,0 +1,295 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFSoakBenchmark.h"
+#include "AndroidPerformanceLog.h"
+#include "ADPFManager.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceSoakMinutes(
+    TEXT("r.AndroidPerformanceSoakMinutes"),
+    30.0f,
+    TEXT("Minutes of each soak benchmark phase, one with the plugin enabled and one disabled."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceSoakCooldownMinutes(
+    TEXT("r.AndroidPerformanceSoakCooldownMinutes"),
+    5.0f,
+    TEXT("Minimum minutes between the two soak benchmark phases, for the device to cool down. Not measured."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceSoakCooldownTimeoutMinutes(
+    TEXT("r.AndroidPerformanceSoakCooldownTimeoutMinutes"),
+    30.0f,
+    TEXT("Maximum minutes the soak benchmark waits for the thermal headroom and status to return to their values at\n")
+    TEXT("the start of the first phase. The second phase starts warmer after the timeout."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceSoakMap(
+    TEXT("r.AndroidPerformanceSoakMap"),
+    TEXT(""),
+    TEXT("Map opened before the soak benchmark starts. Empty keeps the current map."),
+    ECVF_RenderThreadSafe);
+
+static FAutoConsoleCommand CmdAndroidPerformanceSoakBenchmark(
+    TEXT("r.AndroidPerformanceSoakBenchmark"),
+    TEXT("Run the soak benchmark: the same time with the plugin enabled and disabled, then write a report.\n")
+    TEXT("Optional argument: minutes of each phase, or \"stop\" to abort."),
+    FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args) {
+        if (args.Num() > 0 && args[0].Equals(TEXT("stop"), ESearchCase::IgnoreCase)) {
+            ADPFSoakBenchmark::getInstance().Stop();
+            return;
+        }
+        ADPFSoakBenchmark::getInstance().Start(args.Num() > 0 ? FCString::Atof(*args[0]) : 0.0f, false);
+    }));
+
+// Seconds skipped after the start, so the map load isn't measured.
+static constexpr float kSoakWarmupSeconds = 10.0f;
+
+// Headroom above the start of the first phase still counted as cooled down,
+// as the headroom drifts with the ambient temperature.
+static constexpr float kSoakCooldownHeadroomMargin = 0.02f;
+
+static const TCHAR* const kSoakEnabledCVar = TEXT("r.AndroidPerformanceEnabled");
+
+// Runs are counted in the user settings, so that automated runs, which exit
+// after the report, alternate the phase order too.
+static const TCHAR* const kSoakConfigSection = TEXT("AndroidPerformance.SoakBenchmark");
+static const TCHAR* const kSoakRunCountKey = TEXT("RunCount");
+
+static void SetPluginEnabled(int32 enabled) {
+    if (IConsoleVariable* cvar = IConsoleManager::Get().FindConsoleVariable(kSoakEnabledCVar)) {
+        cvar->Set(enabled, ECVF_SetByCode);
+    }
+}
+
+ADPFSoakBenchmark::ADPFSoakBenchmark()
+        : phase_(EPhase::Idle),
+            governor_first_(true),
+            phase_seconds_(0.f),
+            elapsed_(0.f),
+            quit_(false),
+            saved_enabled_(1),
+            sustained_seconds_(0.f),
+            sustained_frames_(0),
+            start_quality_changes_(0) {
+}
+
+ADPFSoakBenchmark::~ADPFSoakBenchmark() {
+    if (tick_handle_.IsValid()) {
+        FTSTicker::GetCoreTicker().RemoveTicker(tick_handle_);
+    }
+}
+
+void ADPFSoakBenchmark::Start(float minutes, bool quit) {
+    Stop();
+
+    if (minutes <= 0.0f) {
+        minutes = CVarAndroidPerformanceSoakMinutes.GetValueOnGameThread();
+    }
+    phase_seconds_ = FMath::Max(minutes, 0.1f) * 60.0f;
+    quit_ = quit;
+    if (IConsoleVariable* cvar = IConsoleManager::Get().FindConsoleVariable(kSoakEnabledCVar)) {
+        saved_enabled_ = cvar->GetInt();
+    }
+    results_.Reset();
+
+    int32 run_count = 0;
+    if (GConfig != nullptr) {
+        GConfig->GetInt(kSoakConfigSection, kSoakRunCountKey, run_count, GGameUserSettingsIni);
+        GConfig->SetInt(kSoakConfigSection, kSoakRunCountKey, run_count + 1, GGameUserSettingsIni);
+        GConfig->Flush(false, GGameUserSettingsIni);
+    }
+    governor_first_ = run_count % 2 == 0;
+
+    const FString map = CVarAndroidPerformanceSoakMap.GetValueOnGameThread();
+    if (!map.IsEmpty() && GEngine != nullptr) {
+        GEngine->DeferredCommands.Add(FString::Printf(TEXT("open %s"), *map));
+    }
+
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark started, %.1f minutes per phase, plugin %s first."),
+            phase_seconds_ / 60.0f, governor_first_ ? TEXT("enabled") : TEXT("disabled"));
+    tick_handle_ = FTSTicker::GetCoreTicker().AddTicker(
+            FTickerDelegate::CreateRaw(this, &ADPFSoakBenchmark::Tick));
+    phase_ = EPhase::Warmup;
+    elapsed_ = 0.0f;
+}
+
+void ADPFSoakBenchmark::Stop() {
+    if (!tick_handle_.IsValid()) {
+        return;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark stopped."));
+    FTSTicker::GetCoreTicker().RemoveTicker(tick_handle_);
+    tick_handle_.Reset();
+    phase_ = EPhase::Idle;
+    SetPluginEnabled(saved_enabled_);
+}
+
+void ADPFSoakBenchmark::BeginPhase(EPhase phase) {
+    phase_ = phase;
+    elapsed_ = 0.0f;
+    if (phase == EPhase::Cooldown) {
+        return;
+    }
+
+    // Both phases start from the same quality and frame rate.
+    const bool governor = (phase == EPhase::First) == governor_first_;
+    ADPFManager& manager = ADPFManager::getInstance();
+    manager.RestoreDefaultQuality();
+    SetPluginEnabled(governor ? 1 : 0);
+
+    const ADPFThermalSnapshot snapshot = manager.GetThermalSnapshot();
+    current_ = ADPFSoakPhaseResult();
+    current_.governor = governor;
+    current_.start_thermal_status = snapshot.status;
+    current_.max_thermal_status = current_.start_thermal_status;
+    current_.start_headroom = snapshot.headroom;
+    current_.battery_start = FPlatformMisc::GetBatteryLevel();
+    histogram_.Reset();
+    sustained_seconds_ = 0.0f;
+    sustained_frames_ = 0;
+    start_quality_changes_ = manager.GetQualityChangeCount();
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark phase with the plugin %s, thermal status %d headroom %.2f."),
+            governor ? TEXT("enabled") : TEXT("disabled"), current_.start_thermal_status, current_.start_headroom);
+}
+
+// Whether the device is back to the thermal state the first phase started
+// with.
+bool ADPFSoakBenchmark::IsCooledDown() const {
+    if (results_.Num() == 0) {
+        return true;
+    }
+    const ADPFSoakPhaseResult& first = results_[0];
+    const ADPFThermalSnapshot snapshot = ADPFManager::getInstance().GetThermalSnapshot();
+    return snapshot.status <= first.start_thermal_status &&
+            snapshot.headroom <= first.start_headroom + kSoakCooldownHeadroomMargin;
+}
+
+void ADPFSoakBenchmark::EndPhase() {
+    const ADPFManager& manager = ADPFManager::getInstance();
+    current_.seconds = elapsed_;
+    current_.mean_fps = elapsed_ > 0.0f ? current_.frames / elapsed_ : 0.0f;
+    current_.sustained_fps = sustained_seconds_ > 0.0f ? sustained_frames_ / sustained_seconds_ : 0.0f;
+    current_.frame_stats = histogram_.GetStats();
+    current_.quality_changes = manager.GetQualityChangeCount() - start_quality_changes_;
+    current_.battery_end = FPlatformMisc::GetBatteryLevel();
+    results_.Add(current_);
+}
+
+bool ADPFSoakBenchmark::Tick(float delta_time) {
+    elapsed_ += delta_time;
+
+    switch (phase_) {
+        case EPhase::Warmup:
+            if (elapsed_ >= kSoakWarmupSeconds) {
+                BeginPhase(EPhase::First);
+            }
+            return true;
+        case EPhase::Cooldown: {
+            if (elapsed_ < CVarAndroidPerformanceSoakCooldownMinutes.GetValueOnGameThread() * 60.0f) {
+                return true;
+            }
+            const bool timed_out = elapsed_ >= CVarAndroidPerformanceSoakCooldownTimeoutMinutes.GetValueOnGameThread() * 60.0f;
+            if (!timed_out && !IsCooledDown()) {
+                return true;
+            }
+            if (timed_out) {
+                UE_LOG(LogAndroidPerformance, Warning,
+                        TEXT("Soak benchmark cool down timed out after %.1f minutes, the second phase starts warmer."),
+                        elapsed_ / 60.0f);
+            } else {
+                UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark cooled down in %.1f minutes."), elapsed_ / 60.0f);
+            }
+            BeginPhase(EPhase::Second);
+            return true;
+        }
+        case EPhase::Idle:
+            tick_handle_.Reset();
+            return false;
+        default:
+            break;
+    }
+
+    const ADPFManager& manager = ADPFManager::getInstance();
+    const float frame_ms = delta_time * 1000.0f;
+    histogram_.Add(frame_ms, frame_ms > manager.GetJankThresholdMs());
+    current_.frames++;
+    if (elapsed_ >= phase_seconds_ * 0.5f) {
+        sustained_seconds_ += delta_time;
+        sustained_frames_++;
+    }
+
+    const int32 status = manager.GetThermalSnapshot().status;
+    current_.max_thermal_status = FMath::Max(current_.max_thermal_status, status);
+    if (current_.time_to_throttle < 0.0f && status >= ATHERMAL_STATUS_LIGHT) {
+        current_.time_to_throttle = elapsed_;
+    }
+
+    if (elapsed_ < phase_seconds_) {
+        return true;
+    }
+    EndPhase();
+    if (phase_ == EPhase::First) {
+        BeginPhase(EPhase::Cooldown);
+        return true;
+    }
+
+    // Done.
+    WriteReport();
+    phase_ = EPhase::Idle;
+    tick_handle_.Reset();
+    SetPluginEnabled(saved_enabled_);
+    if (quit_) {
+        FPlatformMisc::RequestExit(false);
+    }
+    return false;
+}
+
+void ADPFSoakBenchmark::WriteReport() const {
+    FString csv = TEXT("governor,seconds,frames,mean_fps,sustained_fps,p50_ms,p95_ms,p99_ms,jank,quality_changes,")
+            TEXT("time_to_throttle_s,start_thermal_status,max_thermal_status,start_headroom,battery_start,battery_end,")
+            TEXT("battery_drain_per_hour\n");
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark report on %s:"), *FPlatformMisc::GetDeviceMakeAndModel());
+    for (const ADPFSoakPhaseResult& result : results_) {
+        const bool has_battery = result.battery_start >= 0 && result.battery_end >= 0 && result.seconds > 0.0f;
+        const float drain_per_hour = has_battery ?
+                (result.battery_start - result.battery_end) * 3600.0f / result.seconds : -1.0f;
+        UE_LOG(LogAndroidPerformance, Log,
+                TEXT("  Plugin %s: FPS %.1f sustained %.1f P99 %.1f ms jank %u quality changes %u throttle after %.0fs status %d-%d battery %.1f%%/h"),
+                result.governor ? TEXT("on ") : TEXT("off"), result.mean_fps, result.sustained_fps, result.frame_stats.p99_ms,
+                result.frame_stats.jank_count, result.quality_changes, result.time_to_throttle,
+                result.start_thermal_status, result.max_thermal_status, drain_per_hour);
+        csv += FString::Printf(TEXT("%d,%.1f,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%u,%u,%.1f,%d,%d,%.3f,%d,%d,%.2f\n"),
+                result.governor ? 1 : 0, result.seconds, result.frames, result.mean_fps, result.sustained_fps,
+                result.frame_stats.p50_ms, result.frame_stats.p95_ms, result.frame_stats.p99_ms, result.frame_stats.jank_count,
+                result.quality_changes, result.time_to_throttle, result.start_thermal_status, result.max_thermal_status,
+                result.start_headroom, result.battery_start, result.battery_end, drain_per_hour);
+    }
+
+    const FString path = FPaths::Combine(FPaths::ProfilingDir(), TEXT("AndroidPerformance"),
+            FString::Printf(TEXT("SoakBenchmark-%s.csv"), *FDateTime::Now().ToString()));
+    if (FFileHelper::SaveStringToFile(csv, *path)) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Soak benchmark report written to %s."), *path);
+    } else {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Failed to write the soak benchmark report %s."), *path);
+    }
+}
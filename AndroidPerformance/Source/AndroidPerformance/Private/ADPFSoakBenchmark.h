@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_SOAK_BENCHMARK_H_
+#define ADPF_SOAK_BENCHMARK_H_
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "ADPFFrameHistogram.h"
+
+// Results of one soak benchmark phase.
+struct ADPFSoakPhaseResult {
+    bool governor = false;
+    float seconds = 0.f;
+    uint32 frames = 0;
+    float mean_fps = 0.f;
+    // Mean FPS over the second half of the phase, once the device is warm.
+    float sustained_fps = 0.f;
+    ADPFFrameTimeStats frame_stats;
+    uint32 quality_changes = 0;
+    // Seconds until the thermal status first reached LIGHT, -1 if never.
+    float time_to_throttle = -1.f;
+    int32 start_thermal_status = 0;
+    int32 max_thermal_status = 0;
+    float start_headroom = 0.f;
+    // Battery level in percent, -1 if the platform doesn't report it.
+    int32 battery_start = -1;
+    int32 battery_end = -1;
+};
+
+/*
+ * ADPFSoakBenchmark plays the game for a fixed time with the plugin enabled,
+ * lets the device cool down to where the first phase started, plays the same
+ * time with the plugin disabled, and writes a report comparing the two
+ * phases. Runs alternate which phase comes first. It measures the frames
+ * itself, since Monitor() doesn't run while the plugin is disabled. Game
+ * thread only.
+ */
+class ADPFSoakBenchmark {
+ public:
+    // Singleton function.
+    static ADPFSoakBenchmark& getInstance() {
+        static ADPFSoakBenchmark instance;
+        return instance;
+    }
+    ~ADPFSoakBenchmark();
+    ADPFSoakBenchmark(ADPFSoakBenchmark const&) = delete;
+    void operator=(ADPFSoakBenchmark const&) = delete;
+
+    // Start with phases of the given length, r.AndroidPerformanceSoakMinutes
+    // if 0 or less. Exit the app after the report if quit is set.
+    void Start(float minutes, bool quit);
+    void Stop();
+
+    bool IsRunning() const { return phase_ != EPhase::Idle; }
+
+ private:
+    enum class EPhase : uint8 {
+        Idle,
+        // Skips the map load and the first frames.
+        Warmup,
+        First,
+        // Waits until the device is back to the thermal state the first
+        // phase started with.
+        Cooldown,
+        Second,
+    };
+
+    ADPFSoakBenchmark();
+
+    bool Tick(float delta_time);
+    void BeginPhase(EPhase phase);
+    void EndPhase();
+    void WriteReport() const;
+    bool IsCooledDown() const;
+
+    EPhase phase_;
+    // Whether the first phase runs with the plugin enabled.
+    bool governor_first_;
+    float phase_seconds_;
+    float elapsed_;
+    bool quit_;
+    int32 saved_enabled_;
+    FTSTicker::FDelegateHandle tick_handle_;
+
+    ADPFFrameHistogram histogram_;
+    float sustained_seconds_;
+    uint32 sustained_frames_;
+    uint32 start_quality_changes_;
+    ADPFSoakPhaseResult current_;
+    TArray<ADPFSoakPhaseResult> results_;
+};
+
+#endif    // ADPF_SOAK_BENCHMARK_H_
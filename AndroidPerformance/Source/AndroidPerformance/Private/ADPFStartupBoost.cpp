@@ -0,0 +1,139 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFStartupBoost.h"
+#include "ADPFNativeApi.h"
+#include "ADPFStats.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceStartupBoostTarget(
+    TEXT("r.AndroidPerformanceStartupBoostTarget"),
+    4.0f,
+    TEXT("Target work duration in milliseconds of the startup boost session. The lower it is, the harder the boost."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceStartupBoostReportInterval(
+    TEXT("r.AndroidPerformanceStartupBoostReportInterval"),
+    0.05f,
+    TEXT("Seconds between two reports to the startup boost session."),
+    ECVF_RenderThreadSafe);
+
+// The loading threads are created while the game starts, look for new ones
+// this often.
+static constexpr double kStartupBoostRescanInterval = 1.0;
+
+ADPFStartupBoost::ADPFStartupBoost()
+        : thread_(nullptr),
+            wake_event_(nullptr),
+            stop_requested_(false) {
+}
+
+ADPFStartupBoost::~ADPFStartupBoost() {
+    Shutdown();
+}
+
+bool ADPFStartupBoost::Start(CollectFunction collect_function) {
+    if (thread_ != nullptr) {
+        return true;
+    }
+    if (!ADPFNativeApi::Get().IsPerformanceHintAvailable()) {
+        return false;
+    }
+
+    collect_function_ = MoveTemp(collect_function);
+    stop_requested_ = false;
+    wake_event_ = FPlatformProcess::GetSynchEventFromPool(false);
+    thread_ = FRunnableThread::Create(this, TEXT("ADPFStartupBoost"), 0, TPri_Normal);
+    if (thread_ == nullptr) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to create the startup boost thread."));
+        FPlatformProcess::ReturnSynchEventToPool(wake_event_);
+        wake_event_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void ADPFStartupBoost::Shutdown() {
+    if (thread_ == nullptr) {
+        return;
+    }
+    thread_->Kill(true);
+    delete thread_;
+    thread_ = nullptr;
+    FPlatformProcess::ReturnSynchEventToPool(wake_event_);
+    wake_event_ = nullptr;
+}
+
+uint32 ADPFStartupBoost::Run() {
+    const ADPFNativeApi& api = ADPFNativeApi::Get();
+    APerformanceHintManager* manager = api.get_manager();
+    if (manager == nullptr) {
+        return 0;
+    }
+
+    TArray<int32> thread_ids;
+    collect_function_(thread_ids);
+    const int64 target_ns = static_cast<int64>(
+            FMath::Max(CVarAndroidPerformanceStartupBoostTarget.GetValueOnAnyThread(), 0.1f) * 1e6);
+    APerformanceHintSession* session = api.create_session(manager, thread_ids.GetData(), thread_ids.Num(), target_ns);
+    if (session == nullptr) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to create the startup boost session."));
+        return 0;
+    }
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Startup boost over %d threads"), thread_ids.Num());
+
+    double last_report = FPlatformTime::Seconds();
+    double last_scan = last_report;
+    TArray<int32> scanned_thread_ids;
+    while (!stop_requested_) {
+        const float interval = FMath::Max(CVarAndroidPerformanceStartupBoostReportInterval.GetValueOnAnyThread(), 0.001f);
+        wake_event_->Wait(FTimespan::FromSeconds(interval));
+        if (stop_requested_) {
+            break;
+        }
+
+        ADPF_SCOPE(StartupBoost);
+        // Everything since the last report counts as one long frame.
+        const double now = FPlatformTime::Seconds();
+        api.report_actual_work_duration(session, static_cast<int64>((now - last_report) * 1e9));
+        last_report = now;
+
+        if (now - last_scan >= kStartupBoostRescanInterval && api.set_threads != nullptr) {
+            last_scan = now;
+            collect_function_(scanned_thread_ids);
+            if (scanned_thread_ids != thread_ids) {
+                thread_ids = scanned_thread_ids;
+                api.set_threads(session, thread_ids.GetData(), thread_ids.Num());
+            }
+        }
+    }
+
+    api.close_session(session);
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Startup boost ended"));
+    return 0;
+}
+
+void ADPFStartupBoost::Stop() {
+    stop_requested_ = true;
+    if (wake_event_ != nullptr) {
+        wake_event_->Trigger();
+    }
+}
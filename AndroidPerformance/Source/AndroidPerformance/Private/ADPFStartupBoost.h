@@ -0,0 +1,62 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_STARTUP_BOOST_H_
+#define ADPF_STARTUP_BOOST_H_
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+class FRunnableThread;
+class FEvent;
+struct APerformanceHintSession;
+
+/*
+ * ADPFStartupBoost keeps a hint session over the loading threads from module
+ * startup until the first interactive frame. A session only boosts while
+ * durations are reported to it, and startup has few frames to report, so its
+ * own thread reports the time elapsed since the last report against a short
+ * target. The thread makes every call on the session.
+ */
+class ADPFStartupBoost : public FRunnable {
+ public:
+    // Called on the boost thread. Fills the sorted ids of the boosted threads.
+    using CollectFunction = TFunction<void(TArray<int32>&)>;
+
+    ADPFStartupBoost();
+    ~ADPFStartupBoost();
+
+    // Start boosting, needs the API 33 NDK functions. Returns false if the
+    // boost didn't start.
+    bool Start(CollectFunction collect_function);
+    // Close the session and stop the thread. Blocks until it has exited.
+    void Shutdown();
+
+    bool IsRunning() const { return thread_ != nullptr; }
+
+    // FRunnable interface.
+    uint32 Run() override;
+    void Stop() override;
+
+ private:
+    CollectFunction collect_function_;
+    FRunnableThread* thread_;
+    FEvent* wake_event_;
+    std::atomic<bool> stop_requested_;
+};
+
+#endif    // ADPF_STARTUP_BOOST_H_
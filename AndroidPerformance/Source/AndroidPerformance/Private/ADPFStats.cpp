@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFStats.h"
+
+UE_TRACE_CHANNEL_DEFINE(AndroidPerformanceChannel)
+
+CSV_DEFINE_CATEGORY(AndroidPerformance, true);
+
+DEFINE_STAT(STAT_ADPF_GameWork);
+DEFINE_STAT(STAT_ADPF_RenderWork);
+DEFINE_STAT(STAT_ADPF_RHIWork);
+DEFINE_STAT(STAT_ADPF_GPUWork);
+DEFINE_STAT(STAT_ADPF_TargetWork);
+DEFINE_STAT(STAT_ADPF_MissRate);
+DEFINE_STAT(STAT_ADPF_PerformanceBudget);
+DEFINE_STAT(STAT_ADPF_ThermalHeadroom);
+DEFINE_STAT(STAT_ADPF_CPUHeadroom);
+DEFINE_STAT(STAT_ADPF_GPUHeadroom);
+DEFINE_STAT(STAT_ADPF_ThermalStatus);
+DEFINE_STAT(STAT_ADPF_QualityLevel);
+DEFINE_STAT(STAT_ADPF_MemoryPressure);
+DEFINE_STAT(STAT_ADPF_MonitorCost);
+DEFINE_STAT(STAT_ADPF_TotalCost);
+
+DEFINE_STAT(STAT_ADPF_Monitor);
+DEFINE_STAT(STAT_ADPF_ReportWorkDuration);
+DEFINE_STAT(STAT_ADPF_CreateSession);
+DEFINE_STAT(STAT_ADPF_SetThreads);
+DEFINE_STAT(STAT_ADPF_CloseSession);
+DEFINE_STAT(STAT_ADPF_WorkloadHint);
+DEFINE_STAT(STAT_ADPF_ThermalSample);
+DEFINE_STAT(STAT_ADPF_GameState);
+DEFINE_STAT(STAT_ADPF_StartupBoost);
+
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_GameWork, TEXT("AndroidPerformance/GameWork"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_RenderWork, TEXT("AndroidPerformance/RenderWork"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_RHIWork, TEXT("AndroidPerformance/RHIWork"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_GPUWork, TEXT("AndroidPerformance/GPUWork"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_TargetWork, TEXT("AndroidPerformance/TargetWork"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_MissRate, TEXT("AndroidPerformance/MissRate"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_PerformanceBudget, TEXT("AndroidPerformance/PerformanceBudget"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_ThermalHeadroom, TEXT("AndroidPerformance/ThermalHeadroom"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_CPUHeadroom, TEXT("AndroidPerformance/CPUHeadroom"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_GPUHeadroom, TEXT("AndroidPerformance/GPUHeadroom"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_ThermalStatus, TEXT("AndroidPerformance/ThermalStatus"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_QualityLevel, TEXT("AndroidPerformance/QualityLevel"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_MemoryPressure, TEXT("AndroidPerformance/MemoryPressure"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_MonitorCost, TEXT("AndroidPerformance/MonitorCost"));
+TRACE_DECLARE_FLOAT_COUNTER(ADPF_TotalCost, TEXT("AndroidPerformance/TotalCost"));
+
+std::atomic<ADPFThreadCostCounters*> ADPFCostCounters::threads_(nullptr);
+
+// Depth of the timed scopes on this thread.
+static thread_local int32 GADPFCostScopeDepth = 0;
+static thread_local ADPFThreadCostCounters* GADPFThreadCostCounters = nullptr;
+
+ADPFThreadCostCounters& ADPFCostCounters::GetThreadCounters() {
+    if (GADPFThreadCostCounters == nullptr) {
+        ADPFThreadCostCounters* counters = new ADPFThreadCostCounters();
+        counters->next = threads_.load(std::memory_order_relaxed);
+        while (!threads_.compare_exchange_weak(counters->next, counters, std::memory_order_release,
+                std::memory_order_relaxed)) {
+        }
+        GADPFThreadCostCounters = counters;
+    }
+    return *GADPFThreadCostCounters;
+}
+
+// Only this thread writes its counters, so a plain store is enough and the
+// hot path takes no locked instruction.
+static void AddRelaxed(std::atomic<int64>& counter, int64 value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void ADPFCostCounters::Add(EADPFCost cost, int64 duration_ns, bool outermost) {
+    ADPFThreadCostCounters& counters = GetThreadCounters();
+    const int32 index = static_cast<int32>(cost);
+    AddRelaxed(counters.nanos[index], duration_ns);
+    AddRelaxed(counters.calls[index], 1);
+    if (outermost) {
+        AddRelaxed(counters.total_nanos, duration_ns);
+    }
+}
+
+int64 ADPFCostCounters::GetNanos(EADPFCost cost) {
+    int64 nanos = 0;
+    for (const ADPFThreadCostCounters* counters = threads_.load(std::memory_order_acquire); counters != nullptr;
+            counters = counters->next) {
+        nanos += counters->nanos[static_cast<int32>(cost)].load(std::memory_order_relaxed);
+    }
+    return nanos;
+}
+
+int64 ADPFCostCounters::GetCalls(EADPFCost cost) {
+    int64 calls = 0;
+    for (const ADPFThreadCostCounters* counters = threads_.load(std::memory_order_acquire); counters != nullptr;
+            counters = counters->next) {
+        calls += counters->calls[static_cast<int32>(cost)].load(std::memory_order_relaxed);
+    }
+    return calls;
+}
+
+int64 ADPFCostCounters::GetTotalNanos() {
+    int64 nanos = 0;
+    for (const ADPFThreadCostCounters* counters = threads_.load(std::memory_order_acquire); counters != nullptr;
+            counters = counters->next) {
+        nanos += counters->total_nanos.load(std::memory_order_relaxed);
+    }
+    return nanos;
+}
+
+const TCHAR* ADPFCostCounters::GetName(EADPFCost cost) {
+    switch (cost) {
+        case EADPFCost::Monitor: return TEXT("Monitor");
+        case EADPFCost::ReportWorkDuration: return TEXT("ReportWorkDuration");
+        case EADPFCost::CreateSession: return TEXT("CreateSession");
+        case EADPFCost::SetThreads: return TEXT("SetThreads");
+        case EADPFCost::CloseSession: return TEXT("CloseSession");
+        case EADPFCost::WorkloadHint: return TEXT("WorkloadHint");
+        case EADPFCost::ThermalSample: return TEXT("ThermalSample");
+        case EADPFCost::GameState: return TEXT("GameState");
+        case EADPFCost::StartupBoost: return TEXT("StartupBoost");
+        default: return TEXT("Unknown");
+    }
+}
+
+ADPFCostScope::ADPFCostScope(EADPFCost cost)
+        : cost_(cost),
+            start_cycles_(FPlatformTime::Cycles64()),
+            outermost_(GADPFCostScopeDepth++ == 0) {
+}
+
+ADPFCostScope::~ADPFCostScope() {
+    const int64 duration_ns = CyclesToNanos(FPlatformTime::Cycles64() - start_cycles_);
+    --GADPFCostScopeDepth;
+    ADPFCostCounters::Add(cost_, duration_ns, outermost_);
+}
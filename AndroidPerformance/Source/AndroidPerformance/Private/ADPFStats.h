@@ -0,0 +1,170 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_STATS_H_
+#define ADPF_STATS_H_
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+#include <atomic>
+
+// Trace channel of the ADPF call scopes, enable it with
+// -trace=AndroidPerformance.
+UE_TRACE_CHANNEL_EXTERN(AndroidPerformanceChannel)
+
+CSV_DECLARE_CATEGORY_EXTERN(AndroidPerformance);
+
+DECLARE_STATS_GROUP(TEXT("AndroidPerformance"), STATGROUP_AndroidPerformance, STATCAT_Advanced);
+
+// Governor state, durations in milliseconds.
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Game work"), STAT_ADPF_GameWork, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Render work"), STAT_ADPF_RenderWork, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("RHI work"), STAT_ADPF_RHIWork, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU work"), STAT_ADPF_GPUWork, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Target work"), STAT_ADPF_TargetWork, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Missed deadline rate"), STAT_ADPF_MissRate, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Performance budget"), STAT_ADPF_PerformanceBudget, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Thermal headroom"), STAT_ADPF_ThermalHeadroom, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("CPU headroom"), STAT_ADPF_CPUHeadroom, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU headroom"), STAT_ADPF_GPUHeadroom, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Thermal status"), STAT_ADPF_ThermalStatus, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Quality level"), STAT_ADPF_QualityLevel, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Memory pressure"), STAT_ADPF_MemoryPressure, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Monitor cost"), STAT_ADPF_MonitorCost, STATGROUP_AndroidPerformance, );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("ADPF cost"), STAT_ADPF_TotalCost, STATGROUP_AndroidPerformance, );
+
+// Cost of the governor and of every ADPF call.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Monitor"), STAT_ADPF_Monitor, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Report work duration"), STAT_ADPF_ReportWorkDuration, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Create session"), STAT_ADPF_CreateSession, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Set threads"), STAT_ADPF_SetThreads, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Close session"), STAT_ADPF_CloseSession, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Workload hint"), STAT_ADPF_WorkloadHint, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Thermal sample"), STAT_ADPF_ThermalSample, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Game state"), STAT_ADPF_GameState, STATGROUP_AndroidPerformance, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Startup boost"), STAT_ADPF_StartupBoost, STATGROUP_AndroidPerformance, );
+
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_GameWork);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_RenderWork);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_RHIWork);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_GPUWork);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_TargetWork);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_MissRate);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_PerformanceBudget);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_ThermalHeadroom);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_CPUHeadroom);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_GPUHeadroom);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_ThermalStatus);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_QualityLevel);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_MemoryPressure);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_MonitorCost);
+TRACE_DECLARE_FLOAT_COUNTER_EXTERN(ADPF_TotalCost);
+
+// FPlatformTime cycles to nanoseconds.
+inline int64 CyclesToNanos(uint64 cycles) {
+    return static_cast<int64>(FPlatformTime::ToSeconds64(cycles) * 1e9);
+}
+
+// The timed scopes, one per cycle stat above.
+enum class EADPFCost : uint8 {
+    Monitor,
+    ReportWorkDuration,
+    CreateSession,
+    SetThreads,
+    CloseSession,
+    WorkloadHint,
+    ThermalSample,
+    GameState,
+    StartupBoost,
+    Count
+};
+
+// Cost counters of one thread, on their own cache line so that the threads
+// that report work durations don't share one.
+struct alignas(PLATFORM_CACHE_LINE_SIZE) ADPFThreadCostCounters {
+    std::atomic<int64> nanos[static_cast<int32>(EADPFCost::Count)] = {};
+    std::atomic<int64> calls[static_cast<int32>(EADPFCost::Count)] = {};
+    std::atomic<int64> total_nanos{0};
+    // Next thread's counters, in the order the threads first added a cost.
+    ADPFThreadCostCounters* next = nullptr;
+};
+
+// Time spent in the timed scopes since startup, summed over all threads.
+// Unlike the cycle stats, these are kept in shipping builds. Each thread
+// adds to its own counters, the getters sum them.
+class ADPFCostCounters {
+ public:
+    static void Add(EADPFCost cost, int64 duration_ns, bool outermost);
+
+    // Inclusive time and call count of one scope.
+    static int64 GetNanos(EADPFCost cost);
+    static int64 GetCalls(EADPFCost cost);
+    // Time of the outermost scopes only, so nested calls count once.
+    static int64 GetTotalNanos();
+
+    static const TCHAR* GetName(EADPFCost cost);
+
+ private:
+    static ADPFThreadCostCounters& GetThreadCounters();
+
+    // Counters of every thread that added a cost. They are never freed, so
+    // the cost of threads that ended still counts.
+    static std::atomic<ADPFThreadCostCounters*> threads_;
+};
+
+// Adds the duration of its scope to the cost counters.
+class ADPFCostScope {
+ public:
+    explicit ADPFCostScope(EADPFCost cost);
+    ~ADPFCostScope();
+
+ private:
+    EADPFCost cost_;
+    uint64 start_cycles_;
+    bool outermost_;
+};
+
+// Set a governor value in the stat group, the CSV profiler and the trace
+// counters at once. Name is one of the counters above, without prefix.
+#define ADPF_RECORD_VALUE(Name, Value) \
+    do { \
+        const float adpf_value = static_cast<float>(Value); \
+        SET_FLOAT_STAT(STAT_ADPF_##Name, adpf_value); \
+        CSV_CUSTOM_STAT(AndroidPerformance, Name, adpf_value, ECsvCustomStatOp::Set); \
+        TRACE_COUNTER_SET(ADPF_##Name, adpf_value); \
+    } while (0)
+
+// Time a scope in the stat group, on the trace channel and in the cost
+// counters.
+#define ADPF_SCOPE(Name) \
+    SCOPE_CYCLE_COUNTER(STAT_ADPF_##Name); \
+    TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("ADPF_" #Name, AndroidPerformanceChannel); \
+    ADPFCostScope adpf_cost_scope_##Name(EADPFCost::Name)
+
+// A governor transition, shown as a bookmark in Insights and an event in
+// the CSV capture.
+#define ADPF_RECORD_EVENT(Format, ...) \
+    do { \
+        TRACE_BOOKMARK(Format, ##__VA_ARGS__); \
+        CSV_EVENT(AndroidPerformance, Format, ##__VA_ARGS__); \
+    } while (0)
+
+#endif    // ADPF_STATS_H_
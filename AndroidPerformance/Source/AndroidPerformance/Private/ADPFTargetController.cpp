@@ -0,0 +1,170 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFTargetController.h"
+#include "ADPFCVarList.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFramePacer.h"
+
+#if PLATFORM_ANDROID
+#include "Android/AndroidPlatformMisc.h"
+#endif
+
+static TAutoConsoleVariable<int32> CVarAndroidPerformanceTargetController(
+    TEXT("r.AndroidPerformanceTargetController"),
+    1,
+    TEXT("How the hint session target duration is chosen.\n")
+    TEXT(" 0: 1/MaxFPS, 16.6 ms without a max FPS\n")
+    TEXT(" 1: the present interval, scaled by the missed deadline PID loop (default)"),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceTargetBudgetShares(
+    TEXT("r.AndroidPerformanceTargetBudgetShares"),
+    TEXT("0.9,0.85,0.8"),
+    TEXT("Fraction of the frame target given to the Game, Render and RHI thread sessions, leaving slack for the\n")
+    TEXT("later pipeline stages and the GPU."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceTargetBudgetShares(CVarAndroidPerformanceTargetBudgetShares);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceTargetMissRate(
+    TEXT("r.AndroidPerformanceTargetMissRate"),
+    0.05f,
+    TEXT("Fraction of frames allowed to miss the present interval before the target is tightened."),
+    ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<FString> CVarAndroidPerformanceTargetPID(
+    TEXT("r.AndroidPerformanceTargetPID"),
+    TEXT("1.0,0.5,0.0"),
+    TEXT("Proportional, integral and derivative gains of the target loop, from the missed deadline rate error to\n")
+    TEXT("the fraction the target is tightened by."),
+    ECVF_RenderThreadSafe);
+static ADPFCVarList<float> ListAndroidPerformanceTargetPID(CVarAndroidPerformanceTargetPID);
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceTargetMinScale(
+    TEXT("r.AndroidPerformanceTargetMinScale"),
+    0.6f,
+    TEXT("Lowest fraction of the present interval the target is tightened to."),
+    ECVF_RenderThreadSafe);
+
+static constexpr int64 kDefaultFrameIntervalNs = 16666666;
+// A frame misses its deadline when it is presented closer to the next
+// interval than to its own.
+static constexpr float kMissedDeadlineFactor = 1.5f;
+// Seconds over which the missed deadline rate is smoothed.
+static constexpr float kMissRateTimeConstant = 1.0f;
+// Relative target change that is sent to the sessions.
+static constexpr float kMinPublishChange = 0.02f;
+
+ADPFTargetController::ADPFTargetController()
+        : max_fps_(0.f),
+            frame_pace_(0),
+            refresh_rate_(-1),
+            frame_interval_override_ns_(0),
+            frame_interval_ns_(kDefaultFrameIntervalNs),
+            miss_rate_(0.f),
+            integral_(0.f),
+            previous_error_(0.f),
+            scale_(1.f),
+            published_target_ns_(kDefaultFrameIntervalNs) {
+}
+
+void ADPFTargetController::SetMaxFPS(float max_fps) {
+    max_fps_ = max_fps;
+    frame_interval_ns_ = QueryFrameIntervalNs();
+    published_target_ns_ = GetTargetNs();
+}
+
+int64 ADPFTargetController::QueryFrameIntervalNs() {
+    if (frame_interval_override_ns_ > 0) {
+        return frame_interval_override_ns_;
+    }
+    const int64 max_fps_interval_ns = max_fps_ > 0.f ? static_cast<int64>(1e9 / max_fps_) : 0;
+    if (CVarAndroidPerformanceTargetController.GetValueOnGameThread() == 0) {
+        return max_fps_interval_ns > 0 ? max_fps_interval_ns : kDefaultFrameIntervalNs;
+    }
+
+    // The frame pace, Swappy's when it's enabled, includes the sync
+    // interval. Without pacing, frames are presented at the refresh rate.
+    int32 rate = FPlatformRHIFramePacer::GetFramePace();
+    if (rate != frame_pace_) {
+        frame_pace_ = rate;
+        refresh_rate_ = -1;
+    }
+#if PLATFORM_ANDROID
+    if (rate <= 0) {
+        if (refresh_rate_ < 0) {
+            refresh_rate_ = FAndroidMisc::GetNativeDisplayRefreshRate();
+        }
+        rate = refresh_rate_;
+    }
+#endif
+    const int64 present_interval_ns = rate > 0 ? 1000000000LL / rate : kDefaultFrameIntervalNs;
+    // A lower max FPS stretches the interval.
+    return FMath::Max(present_interval_ns, max_fps_interval_ns);
+}
+
+bool ADPFTargetController::Tick(float frame_ms, float delta_time) {
+    // The pace and refresh rate can change at any time.
+    const int64 frame_interval_ns = QueryFrameIntervalNs();
+    const bool interval_changed = frame_interval_ns != frame_interval_ns_;
+    if (interval_changed) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Present interval %.2f ms"), frame_interval_ns * 1e-6f);
+        frame_interval_ns_ = frame_interval_ns;
+    }
+
+    if (CVarAndroidPerformanceTargetController.GetValueOnGameThread() == 0) {
+        miss_rate_ = 0.f;
+        integral_ = 0.f;
+        previous_error_ = 0.f;
+        scale_ = 1.f;
+    } else if (delta_time > 0.f) {
+        const bool missed = frame_ms * 1e6f > frame_interval_ns_ * kMissedDeadlineFactor;
+        const float alpha = delta_time / (kMissRateTimeConstant + delta_time);
+        miss_rate_ = FMath::Lerp(miss_rate_, missed ? 1.f : 0.f, alpha);
+
+        const float kp = ListAndroidPerformanceTargetPID.Get(0, 0.f);
+        const float ki = ListAndroidPerformanceTargetPID.Get(1, 0.f);
+        const float kd = ListAndroidPerformanceTargetPID.Get(2, 0.f);
+        const float min_scale = FMath::Clamp(CVarAndroidPerformanceTargetMinScale.GetValueOnGameThread(), 0.1f, 1.f);
+
+        // Positive while too many frames are late. The integral only holds
+        // a tightening, and no more than the loop can apply.
+        const float error = miss_rate_ - CVarAndroidPerformanceTargetMissRate.GetValueOnGameThread();
+        const float integral_limit = ki > 0.f ? (1.f - min_scale) / ki : 0.f;
+        integral_ = FMath::Clamp(integral_ + error * delta_time, 0.f, integral_limit);
+        const float derivative = (error - previous_error_) / delta_time;
+        previous_error_ = error;
+
+        const float correction = kp * error + ki * integral_ + kd * derivative;
+        scale_ = FMath::Clamp(1.f - correction, min_scale, 1.f);
+    }
+
+    const int64 target_ns = GetTargetNs();
+    if (!interval_changed &&
+            FMath::Abs(target_ns - published_target_ns_) < published_target_ns_ * kMinPublishChange) {
+        return false;
+    }
+    published_target_ns_ = target_ns;
+    return true;
+}
+
+float ADPFTargetController::GetBudgetShare(int32 thread_index) {
+    if (CVarAndroidPerformanceTargetController.GetValueOnAnyThread() == 0) {
+        return 1.f;
+    }
+    return FMath::Clamp(ListAndroidPerformanceTargetBudgetShares.Get(thread_index, 1.f), 0.1f, 1.f);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_TARGET_CONTROLLER_H_
+#define ADPF_TARGET_CONTROLLER_H_
+
+#include "CoreMinimal.h"
+
+/*
+ * ADPFTargetController picks the hint session target duration. The base is
+ * the interval the frames are actually presented at, from the frame pacer,
+ * the max FPS and the display refresh rate. A PID loop on the rate of
+ * frames that miss that interval scales the target down, which asks the
+ * system for more performance, and lets it go back up once frames are on
+ * time. Each thread then gets its budget share of the target. Game thread
+ * only.
+ */
+class ADPFTargetController {
+ public:
+    ADPFTargetController();
+
+    void SetMaxFPS(float max_fps);
+    // Read the display refresh rate again on the next tick, after a display
+    // change.
+    void InvalidateRefreshRate() { refresh_rate_ = -1; }
+    // Use this present interval instead of the frame pacer and the display,
+    // 0 to query them again. Used by the thermal trace replays.
+    void SetFrameIntervalOverride(int64 frame_interval_ns) { frame_interval_override_ns_ = frame_interval_ns; }
+
+    // Call once a frame. Returns true when the target moved enough to be
+    // sent to the sessions again.
+    bool Tick(float frame_ms, float delta_time);
+
+    // Present interval, and the target for the whole frame.
+    int64 GetFrameIntervalNs() const { return frame_interval_ns_; }
+    int64 GetTargetNs() const { return static_cast<int64>(frame_interval_ns_ * scale_); }
+    // Smoothed fraction of frames that missed the present interval.
+    float GetMissRate() const { return miss_rate_; }
+
+    // Fraction of the frame target for a primary thread, by EPerfHintThread.
+    static float GetBudgetShare(int32 thread_index);
+
+ private:
+    int64 QueryFrameIntervalNs();
+
+    float max_fps_;
+    // Frame pace the refresh rate was read for, and the refresh rate, -1
+    // until it's read.
+    int32 frame_pace_;
+    int32 refresh_rate_;
+    int64 frame_interval_override_ns_;
+    int64 frame_interval_ns_;
+    float miss_rate_;
+    float integral_;
+    float previous_error_;
+    float scale_;
+    // Target last reported by Tick(), to skip small changes.
+    int64 published_target_ns_;
+};
+
+#endif    // ADPF_TARGET_CONTROLLER_H_
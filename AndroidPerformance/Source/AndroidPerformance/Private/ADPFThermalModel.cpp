@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFThermalModel.h"
+#include "AndroidPerformanceLog.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+// "ADTM" and the format version.
+static constexpr uint32 kThermalModelMagic = 0x4D544441;
+static constexpr uint32 kThermalModelVersion = 1;
+
+// Seconds of one observation window. The headroom is sampled about once a
+// second and moves by small steps, a longer window keeps the rate readable.
+static constexpr double kThermalModelWindowSeconds = 10.0;
+// A longer window, e.g. across a pause, is dropped.
+static constexpr double kThermalModelMaxWindowSeconds = 30.0;
+// Weight kept by the older observations of a level for each new one, about
+// the last half hour of play at that level counts.
+static constexpr double kThermalModelForgetting = 0.995;
+// Observations a level needs before it's used for predictions.
+static constexpr uint32 kThermalModelMinObservations = 12;
+// Below this headroom variance the samples don't tell the time constant.
+static constexpr double kThermalModelMinHeadroomVariance = 1e-4;
+static constexpr float kThermalModelMinTimeConstant = 10.0f;
+static constexpr float kThermalModelMaxTimeConstant = 7200.0f;
+
+ADPFThermalModel::ADPFThermalModel(int32 level_count)
+        : window_level_(-1),
+            window_headroom_(0.f),
+            window_time_(0.0) {
+    levels_.SetNum(level_count);
+}
+
+void ADPFThermalModel::AddSample(int32 level, float headroom, double time) {
+    if (!levels_.IsValidIndex(level)) {
+        window_level_ = -1;
+        return;
+    }
+    const double elapsed = time - window_time_;
+    if (level != window_level_ || elapsed < 0.0 || elapsed > kThermalModelMaxWindowSeconds) {
+        window_level_ = level;
+        window_headroom_ = headroom;
+        window_time_ = time;
+        return;
+    }
+    if (elapsed < kThermalModelWindowSeconds) {
+        return;
+    }
+
+    AddObservation(level, (window_headroom_ + headroom) * 0.5f, static_cast<float>((headroom - window_headroom_) / elapsed));
+    window_headroom_ = headroom;
+    window_time_ = time;
+}
+
+void ADPFThermalModel::AddObservation(int32 level, float headroom, float rate) {
+    LevelSums& sums = levels_[level];
+    sums.weight = sums.weight * kThermalModelForgetting + 1.0;
+    sums.headroom = sums.headroom * kThermalModelForgetting + headroom;
+    sums.rate = sums.rate * kThermalModelForgetting + rate;
+    sums.headroom_squared = sums.headroom_squared * kThermalModelForgetting + headroom * headroom;
+    sums.headroom_rate = sums.headroom_rate * kThermalModelForgetting + headroom * rate;
+    sums.observation_count++;
+}
+
+void ADPFThermalModel::Reset() {
+    for (LevelSums& sums : levels_) {
+        sums = LevelSums();
+    }
+    window_level_ = -1;
+}
+
+bool ADPFThermalModel::CanPredict(int32 level) const {
+    return levels_.IsValidIndex(level) && levels_[level].observation_count >= kThermalModelMinObservations;
+}
+
+bool ADPFThermalModel::GetFit(int32 level, ADPFThermalModelFit& out_fit) const {
+    out_fit = ADPFThermalModelFit();
+    if (!levels_.IsValidIndex(level) || levels_[level].weight <= 0.0) {
+        return false;
+    }
+    const LevelSums& sums = levels_[level];
+    const double mean_headroom = sums.headroom / sums.weight;
+    const double mean_rate = sums.rate / sums.weight;
+    const double variance = sums.headroom_squared / sums.weight - mean_headroom * mean_headroom;
+    const double covariance = sums.headroom_rate / sums.weight - mean_headroom * mean_rate;
+    out_fit.mean_rate = static_cast<float>(mean_rate);
+    out_fit.observation_count = sums.observation_count;
+
+    // The rate falls as the headroom rises on a settling device, its slope
+    // is -1 / time constant.
+    if (variance > kThermalModelMinHeadroomVariance) {
+        const double slope = covariance / variance;
+        if (slope < 0.0) {
+            out_fit.time_constant = FMath::Clamp(static_cast<float>(-1.0 / slope),
+                    kThermalModelMinTimeConstant, kThermalModelMaxTimeConstant);
+            out_fit.equilibrium = static_cast<float>(mean_headroom + mean_rate * out_fit.time_constant);
+            out_fit.has_time_constant = true;
+        }
+    }
+    return true;
+}
+
+float ADPFThermalModel::PredictPeakHeadroom(int32 level, float headroom, float seconds) const {
+    ADPFThermalModelFit fit;
+    if (!GetFit(level, fit)) {
+        return headroom;
+    }
+    // The first order response is monotonic, so the peak is at one end.
+    const float end_headroom = fit.has_time_constant ?
+            fit.equilibrium + (headroom - fit.equilibrium) * FMath::Exp(-seconds / fit.time_constant) :
+            headroom + fit.mean_rate * seconds;
+    return FMath::Max(headroom, end_headroom);
+}
+
+bool ADPFThermalModel::Load(const FString& path) {
+    TArray<uint8> data;
+    if (!FFileHelper::LoadFileToArray(data, *path, FILEREAD_Silent)) {
+        return false;
+    }
+
+    FMemoryReader reader(data, true);
+    uint32 magic = 0;
+    uint32 version = 0;
+    FString device;
+    int32 level_count = 0;
+    reader << magic << version;
+    if (reader.IsError() || magic != kThermalModelMagic || version != kThermalModelVersion) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("%s is not a version %u thermal model."), *path, kThermalModelVersion);
+        return false;
+    }
+    reader << device << level_count;
+    if (device != FPlatformMisc::GetDeviceMakeAndModel() || level_count != levels_.Num()) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Ignoring the thermal model of %s with %d levels."), *device, level_count);
+        return false;
+    }
+
+    TArray<LevelSums> levels;
+    levels.SetNum(level_count);
+    for (LevelSums& sums : levels) {
+        reader << sums.weight << sums.headroom << sums.rate << sums.headroom_squared << sums.headroom_rate
+                << sums.observation_count;
+    }
+    if (reader.IsError()) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("The thermal model %s is truncated."), *path);
+        return false;
+    }
+    levels_ = MoveTemp(levels);
+    window_level_ = -1;
+    return true;
+}
+
+bool ADPFThermalModel::Save(const FString& path) const {
+    TArray<uint8> data;
+    FMemoryWriter writer(data, true);
+    uint32 magic = kThermalModelMagic;
+    uint32 version = kThermalModelVersion;
+    FString device = FPlatformMisc::GetDeviceMakeAndModel();
+    int32 level_count = levels_.Num();
+    writer << magic << version << device << level_count;
+    for (LevelSums sums : levels_) {
+        writer << sums.weight << sums.headroom << sums.rate << sums.headroom_squared << sums.headroom_rate
+                << sums.observation_count;
+    }
+    if (!FFileHelper::SaveArrayToFile(data, *path)) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Failed to save the thermal model %s."), *path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_THERMAL_MODEL_H_
+#define ADPF_THERMAL_MODEL_H_
+
+#include "CoreMinimal.h"
+
+// Fit of one quality level, see ADPFThermalModel.
+struct ADPFThermalModelFit {
+    // Headroom the device settles at, and the seconds it takes to get 63%
+    // of the way there. Only valid if has_time_constant.
+    float equilibrium = 0.f;
+    float time_constant = 0.f;
+    bool has_time_constant = false;
+    // Mean headroom change per second, used when the samples don't show
+    // the headroom settling yet.
+    float mean_rate = 0.f;
+    uint32 observation_count = 0;
+};
+
+/*
+ * ADPFThermalModel learns how the thermal headroom of this device moves
+ * under each quality level, as a first order system
+ *
+ *   dh/dt = (equilibrium - h) / time_constant
+ *
+ * Each level keeps exponentially weighted least squares sums of the headroom
+ * change rate over the headroom, measured over windows of a few seconds in
+ * which the level didn't change. Old observations fade out, so the model
+ * follows a device that ages or a game that changes. The sums are saved
+ * between sessions. Game thread only.
+ */
+class ADPFThermalModel {
+ public:
+    explicit ADPFThermalModel(int32 level_count);
+
+    // Feed a new headroom sample, taken at time in seconds while level was
+    // applied. A level of -1, e.g. during a level transition, ends the
+    // current window without an observation.
+    void AddSample(int32 level, float headroom, double time);
+    // Forget every observation.
+    void Reset();
+
+    // Whether the level has enough observations for a prediction.
+    bool CanPredict(int32 level) const;
+    bool GetFit(int32 level, ADPFThermalModelFit& out_fit) const;
+    // Highest headroom over the next seconds at level, starting from
+    // headroom. Only valid if CanPredict(level).
+    float PredictPeakHeadroom(int32 level, float headroom, float seconds) const;
+
+    // Returns false if the file is missing or was saved on another device
+    // or with another level count, the model is then left empty.
+    bool Load(const FString& path);
+    bool Save(const FString& path) const;
+
+ private:
+    struct LevelSums {
+        double weight = 0.0;
+        double headroom = 0.0;
+        double rate = 0.0;
+        double headroom_squared = 0.0;
+        double headroom_rate = 0.0;
+        uint32 observation_count = 0;
+    };
+
+    void AddObservation(int32 level, float headroom, float rate);
+
+    TArray<LevelSums> levels_;
+    // Start of the current observation window, level -1 if none.
+    int32 window_level_;
+    float window_headroom_;
+    double window_time_;
+};
+
+#endif    // ADPF_THERMAL_MODEL_H_
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFThermalSampler.h"
+#include "AndroidPerformanceLog.h"
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+#if PLATFORM_ANDROID
+#include "Android/AndroidApplication.h"
+#endif
+
+static TAutoConsoleVariable<float> CVarAndroidPerformanceThermalSampleInterval(
+    TEXT("r.AndroidPerformanceThermalSampleInterval"),
+    1.0f,
+    TEXT("Interval in seconds between thermal headroom samples on the sampler thread.\n")
+    TEXT("Values below 1 second are clamped, since the platform returns NaN when polled faster."),
+    ECVF_RenderThreadSafe);
+
+// The platform rate limits getThermalHeadroom() to about once per second.
+static constexpr float kMinThermalSampleInterval = 1.0f;
+
+ADPFThermalSampler::ADPFThermalSampler(SampleFunction sample_function)
+        : sample_function_(MoveTemp(sample_function)),
+            thread_(nullptr),
+            wake_event_(nullptr),
+            stop_requested_(false) {
+}
+
+ADPFThermalSampler::~ADPFThermalSampler() {
+    Shutdown();
+}
+
+void ADPFThermalSampler::Start(const ADPFThermalSnapshot& initial_snapshot) {
+    if (thread_ != nullptr) {
+        return;
+    }
+    snapshot_.Store(initial_snapshot);
+    stop_requested_ = false;
+    wake_event_ = FPlatformProcess::GetSynchEventFromPool(false);
+    thread_ = FRunnableThread::Create(this, TEXT("ADPFThermalSampler"), 0, TPri_BelowNormal);
+    if (thread_ == nullptr) {
+        UE_LOG(LogAndroidPerformance, Log, TEXT("Failed to create the thermal sampler thread."));
+        FPlatformProcess::ReturnSynchEventToPool(wake_event_);
+        wake_event_ = nullptr;
+    }
+}
+
+void ADPFThermalSampler::Shutdown() {
+    if (thread_ == nullptr) {
+        return;
+    }
+    thread_->Kill(true);
+    delete thread_;
+    thread_ = nullptr;
+    FPlatformProcess::ReturnSynchEventToPool(wake_event_);
+    wake_event_ = nullptr;
+}
+
+uint32 ADPFThermalSampler::Run() {
+    ADPFThermalSnapshot snapshot = snapshot_.Load();
+    while (!stop_requested_) {
+        const float interval = FMath::Max(CVarAndroidPerformanceThermalSampleInterval.GetValueOnAnyThread(),
+                kMinThermalSampleInterval);
+        wake_event_->Wait(FTimespan::FromSeconds(interval));
+        if (stop_requested_) {
+            break;
+        }
+
+        sample_function_(snapshot);
+        snapshot_.Store(snapshot);
+    }
+
+#if PLATFORM_ANDROID
+    // The JNI fallback attached the thread to the VM.
+    FAndroidApplication::DetachJavaEnv();
+#endif
+    return 0;
+}
+
+void ADPFThermalSampler::Stop() {
+    stop_requested_ = true;
+    if (wake_event_ != nullptr) {
+        wake_event_->Trigger();
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_THERMAL_SAMPLER_H_
+#define ADPF_THERMAL_SAMPLER_H_
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "ADPFSeqLock.h"
+
+class FRunnableThread;
+class FEvent;
+
+// Maximum number of thermal headroom forecast horizons.
+static constexpr int32 kMaxThermalForecasts = 4;
+// Longest forecast horizon getThermalHeadroom() accepts, in seconds.
+static constexpr int32 kMaxThermalForecastSeconds = 60;
+
+// Latest thermal sample published by the sampler thread.
+struct ADPFThermalSnapshot {
+    // Thermal headroom, the last valid value if the platform returned NaN.
+    float headroom = 0.f;
+    // Headroom forecasts, the first horizon is always 0 seconds. Only one
+    // horizon is sampled per tick to stay within the platform rate limit.
+    int32 forecast_count = 0;
+    int32 forecast_seconds[kMaxThermalForecasts] = {};
+    float forecast_headroom[kMaxThermalForecasts] = {};
+    // Number of samples taken, used to pick the next forecast horizon.
+    uint32 sample_index = 0;
+    // enum for AThermalStatus
+    int32 status = 0;
+    // CPU and GPU compute headroom from 0 to 100, Android 16 and later.
+    // -1 until sampled.
+    float cpu_headroom = -1.f;
+    float gpu_headroom = -1.f;
+    // Clock() of the last compute headroom sample.
+    int64 system_health_timestamp_ns = 0;
+    // GameManager.getGameMode(), 0 (unsupported) before Android 12.
+    int32 game_mode = 0;
+    // ActivityManager.MemoryInfo in MB, -1 until sampled, and the last
+    // onTrimMemory() level of the process.
+    int32 memory_available_mb = -1;
+    int32 memory_total_mb = -1;
+    int32 memory_threshold_mb = -1;
+    bool low_memory = false;
+    int32 trim_level = 0;
+    // Clock() of the sample, 0 before the first sample.
+    int64 timestamp_ns = 0;
+};
+
+/*
+ * ADPFThermalSampler polls the thermal headroom on its own thread, since the
+ * platform call goes through binder and can stall for milliseconds. Readers
+ * get the latest sample from a seqlock without blocking.
+ */
+class ADPFThermalSampler : public FRunnable {
+ public:
+    // Called on the sampler thread. It updates the fields it could sample and
+    // leaves the others untouched.
+    using SampleFunction = TFunction<void(ADPFThermalSnapshot&)>;
+
+    explicit ADPFThermalSampler(SampleFunction sample_function);
+    ~ADPFThermalSampler();
+
+    // Start polling. The initial snapshot is published until the first
+    // sample, which is taken one interval later.
+    void Start(const ADPFThermalSnapshot& initial_snapshot);
+    void Shutdown();
+    bool IsRunning() const { return thread_ != nullptr; }
+
+    ADPFThermalSnapshot GetSnapshot() const { return snapshot_.Load(); }
+    // Replace the snapshot from outside, for a replay while the thread isn't
+    // running.
+    void Publish(const ADPFThermalSnapshot& snapshot) { snapshot_.Store(snapshot); }
+
+    // FRunnable interface.
+    uint32 Run() override;
+    void Stop() override;
+
+ private:
+    SampleFunction sample_function_;
+    ADPFSeqLock<ADPFThermalSnapshot> snapshot_;
+    FRunnableThread* thread_;
+    FEvent* wake_event_;
+    std::atomic<bool> stop_requested_;
+};
+
+#endif    // ADPF_THERMAL_SAMPLER_H_
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ADPFThermalTrace.h"
+#include "AndroidPerformanceLog.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+// "ADPT" and the format version.
+static constexpr uint32 kThermalTraceMagic = 0x54504441;
+static constexpr uint32 kThermalTraceVersion = 2;
+// Oldest version the reader plays, without frame interval records.
+static constexpr uint32 kThermalTraceMinVersion = 1;
+static constexpr int64 kThermalTraceDefaultFrameIntervalNs = 16666666;
+
+// Buffered bytes written to the file at once.
+static constexpr int32 kThermalTraceFlushSize = 64 * 1024;
+
+// Frame times are stored in 10 us units, up to 655 ms.
+static constexpr float kThermalTraceTimeUnitMs = 0.01f;
+
+enum class EADPFThermalTraceRecord : uint8 {
+    Frame,
+    Thermal,
+    FrameInterval,
+};
+
+static uint16 EncodeTraceTime(float time_ms) {
+    return static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(time_ms / kThermalTraceTimeUnitMs), 0, UINT16_MAX));
+}
+
+ADPFThermalTraceRecorder::ADPFThermalTraceRecorder() {
+}
+
+ADPFThermalTraceRecorder::~ADPFThermalTraceRecorder() {
+    Stop();
+}
+
+bool ADPFThermalTraceRecorder::Start(const FString& path) {
+    Stop();
+
+    IFileManager::Get().MakeDirectory(*FPaths::GetPath(path), true);
+    file_.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*path));
+    if (file_ == nullptr) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Failed to open the thermal trace %s."), *path);
+        return false;
+    }
+
+    // Room for one more record past the flush size.
+    buffer_.Reset(kThermalTraceFlushSize + 256);
+    FMemoryWriter writer(buffer_, true, true);
+    uint32 magic = kThermalTraceMagic;
+    uint32 version = kThermalTraceVersion;
+    FString device = FPlatformMisc::GetDeviceMakeAndModel();
+    writer << magic << version << device;
+
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Recording the thermal trace %s."), *path);
+    return true;
+}
+
+void ADPFThermalTraceRecorder::Stop() {
+    if (file_ == nullptr) {
+        return;
+    }
+    Flush();
+    file_.Reset();
+    buffer_.Empty();
+    UE_LOG(LogAndroidPerformance, Log, TEXT("Thermal trace recording stopped."));
+}
+
+void ADPFThermalTraceRecorder::RecordThermal(const ADPFThermalSnapshot& snapshot, int32 status) {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    FMemoryWriter writer(buffer_, true, true);
+    uint8 tag = static_cast<uint8>(EADPFThermalTraceRecord::Thermal);
+    float headroom = snapshot.headroom;
+    float cpu_headroom = snapshot.cpu_headroom;
+    float gpu_headroom = snapshot.gpu_headroom;
+    uint8 status_byte = static_cast<uint8>(FMath::Clamp(status, 0, UINT8_MAX));
+    uint8 game_mode = static_cast<uint8>(FMath::Clamp(snapshot.game_mode, 0, UINT8_MAX));
+    uint8 forecast_count = static_cast<uint8>(FMath::Clamp(snapshot.forecast_count, 0, kMaxThermalForecasts));
+    writer << tag << headroom << cpu_headroom << gpu_headroom << status_byte << game_mode << forecast_count;
+    for (int32 i = 0; i < forecast_count; ++i) {
+        uint16 seconds = static_cast<uint16>(FMath::Clamp(snapshot.forecast_seconds[i], 0, UINT16_MAX));
+        float forecast_headroom = snapshot.forecast_headroom[i];
+        writer << seconds << forecast_headroom;
+    }
+
+    if (buffer_.Num() >= kThermalTraceFlushSize) {
+        Flush();
+    }
+}
+
+void ADPFThermalTraceRecorder::RecordFrameInterval(int64 frame_interval_ns) {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    FMemoryWriter writer(buffer_, true, true);
+    uint8 tag = static_cast<uint8>(EADPFThermalTraceRecord::FrameInterval);
+    uint32 interval = static_cast<uint32>(FMath::Clamp<int64>(frame_interval_ns, 0, UINT32_MAX));
+    writer << tag << interval;
+
+    if (buffer_.Num() >= kThermalTraceFlushSize) {
+        Flush();
+    }
+}
+
+void ADPFThermalTraceRecorder::RecordFrame(float frame_ms, float work_ms) {
+    if (file_ == nullptr) {
+        return;
+    }
+
+    FMemoryWriter writer(buffer_, true, true);
+    uint8 tag = static_cast<uint8>(EADPFThermalTraceRecord::Frame);
+    uint16 frame_time = EncodeTraceTime(frame_ms);
+    uint16 work_time = EncodeTraceTime(work_ms);
+    writer << tag << frame_time << work_time;
+
+    if (buffer_.Num() >= kThermalTraceFlushSize) {
+        Flush();
+    }
+}
+
+void ADPFThermalTraceRecorder::Flush() {
+    if (file_ == nullptr) {
+        return;
+    }
+    if (buffer_.Num() > 0 && !file_->Write(buffer_.GetData(), buffer_.Num())) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Failed to write the thermal trace."));
+    }
+    // Keeps the allocation.
+    buffer_.Reset();
+}
+
+ADPFThermalTraceReader::ADPFThermalTraceReader()
+        : offset_(0),
+            version_(0),
+            frame_interval_ns_(kThermalTraceDefaultFrameIntervalNs) {
+}
+
+bool ADPFThermalTraceReader::Open(const FString& path) {
+    Close();
+
+    if (!FFileHelper::LoadFileToArray(data_, *path)) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("Failed to read the thermal trace %s."), *path);
+        return false;
+    }
+
+    FMemoryReader reader(data_, true);
+    uint32 magic = 0;
+    uint32 version = 0;
+    reader << magic << version;
+    if (reader.IsError() || magic != kThermalTraceMagic || version < kThermalTraceMinVersion ||
+            version > kThermalTraceVersion) {
+        UE_LOG(LogAndroidPerformance, Warning, TEXT("%s is not a version %u to %u thermal trace."), *path,
+                kThermalTraceMinVersion, kThermalTraceVersion);
+        Close();
+        return false;
+    }
+    reader << device_;
+    if (reader.IsError()) {
+        Close();
+        return false;
+    }
+    offset_ = reader.Tell();
+    version_ = version;
+    return true;
+}
+
+void ADPFThermalTraceReader::Close() {
+    data_.Empty();
+    offset_ = 0;
+    device_.Reset();
+    version_ = 0;
+    thermal_ = ADPFThermalSnapshot();
+    frame_interval_ns_ = kThermalTraceDefaultFrameIntervalNs;
+}
+
+bool ADPFThermalTraceReader::Next(ADPFThermalTraceFrame& out_frame) {
+    FMemoryReader reader(data_, true);
+    reader.Seek(offset_);
+
+    out_frame.thermal_changed = false;
+    while (reader.Tell() < reader.TotalSize()) {
+        uint8 tag = 0;
+        reader << tag;
+
+        if (tag == static_cast<uint8>(EADPFThermalTraceRecord::Frame)) {
+            uint16 frame_time = 0;
+            uint16 work_time = 0;
+            reader << frame_time << work_time;
+            if (reader.IsError()) {
+                break;
+            }
+            out_frame.frame_ms = frame_time * kThermalTraceTimeUnitMs;
+            out_frame.work_ms = work_time * kThermalTraceTimeUnitMs;
+            out_frame.thermal = thermal_;
+            out_frame.frame_interval_ns = frame_interval_ns_;
+            offset_ = reader.Tell();
+            return true;
+        }
+
+        if (tag == static_cast<uint8>(EADPFThermalTraceRecord::FrameInterval) && version_ >= 2) {
+            uint32 interval = 0;
+            reader << interval;
+            if (reader.IsError()) {
+                break;
+            }
+            if (interval > 0) {
+                frame_interval_ns_ = interval;
+            }
+            continue;
+        }
+
+        if (tag != static_cast<uint8>(EADPFThermalTraceRecord::Thermal)) {
+            UE_LOG(LogAndroidPerformance, Warning, TEXT("Unknown thermal trace record %u."), tag);
+            break;
+        }
+        uint8 status = 0;
+        uint8 game_mode = 0;
+        uint8 forecast_count = 0;
+        reader << thermal_.headroom << thermal_.cpu_headroom << thermal_.gpu_headroom << status << game_mode
+                << forecast_count;
+        if (reader.IsError() || forecast_count > kMaxThermalForecasts) {
+            break;
+        }
+        thermal_.status = status;
+        thermal_.game_mode = game_mode;
+        thermal_.forecast_count = forecast_count;
+        for (int32 i = 0; i < forecast_count; ++i) {
+            uint16 seconds = 0;
+            reader << seconds << thermal_.forecast_headroom[i];
+            thermal_.forecast_seconds[i] = seconds;
+        }
+        out_frame.thermal_changed = true;
+    }
+
+    offset_ = data_.Num();
+    return false;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADPF_THERMAL_TRACE_H_
+#define ADPF_THERMAL_TRACE_H_
+
+#include "CoreMinimal.h"
+#include "ADPFThermalSampler.h"
+
+class IFileHandle;
+
+// One frame of a thermal trace and the thermal state it was played with.
+struct ADPFThermalTraceFrame {
+    // Frame time and the longest work duration of the primary threads.
+    float frame_ms = 0.f;
+    float work_ms = 0.f;
+    // Present interval the frame was paced for. Version 1 traces don't
+    // record it and replay at 60 Hz.
+    int64 frame_interval_ns = 0;
+    // True when the thermal state changed in this frame. The timestamp and
+    // sample_index of the snapshot are not recorded.
+    bool thermal_changed = false;
+    ADPFThermalSnapshot thermal;
+};
+
+/*
+ * ADPFThermalTraceRecorder writes the thermal samples and frame timings of a
+ * session as a binary stream. A frame takes 5 bytes, a thermal change about
+ * 20. Records go to a preallocated buffer that is written to the file when
+ * full, so recording a frame doesn't allocate. Game thread only.
+ */
+class ADPFThermalTraceRecorder {
+ public:
+    ADPFThermalTraceRecorder();
+    ~ADPFThermalTraceRecorder();
+
+    bool Start(const FString& path);
+    void Stop();
+
+    bool IsRecording() const { return file_ != nullptr; }
+    // Write the buffered records, e.g. before the app may be killed.
+    void Flush();
+
+    // A thermal or frame interval record applies to the frames recorded
+    // after it.
+    void RecordThermal(const ADPFThermalSnapshot& snapshot, int32 status);
+    void RecordFrameInterval(int64 frame_interval_ns);
+    void RecordFrame(float frame_ms, float work_ms);
+
+ private:
+    TUniquePtr<IFileHandle> file_;
+    TArray<uint8> buffer_;
+};
+
+/*
+ * ADPFThermalTraceReader plays back a trace written by the recorder, one
+ * frame at a time. The whole file is loaded when opened.
+ */
+class ADPFThermalTraceReader {
+ public:
+    ADPFThermalTraceReader();
+
+    bool Open(const FString& path);
+    void Close();
+
+    bool IsOpen() const { return data_.Num() > 0; }
+    // Device the trace was recorded on.
+    const FString& GetDevice() const { return device_; }
+
+    // Read the next frame, false at the end of the trace or on a corrupt
+    // record.
+    bool Next(ADPFThermalTraceFrame& out_frame);
+
+ private:
+    TArray<uint8> data_;
+    int64 offset_;
+    FString device_;
+    uint32 version_;
+    // Latest thermal state and frame interval, carried over to the following
+    // frames.
+    ADPFThermalSnapshot thermal_;
+    int64 frame_interval_ns_;
+};
+
+#endif    // ADPF_THERMAL_TRACE_H_
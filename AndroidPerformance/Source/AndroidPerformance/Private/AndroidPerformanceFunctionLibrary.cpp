@@ -0,0 +1,51 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AndroidPerformanceFunctionLibrary.h"
+#include "ADPFManager.h"
+
+void UAndroidPerformanceFunctionLibrary::NotifyWorkloadIncrease(bool bCPU, bool bGPU)
+{
+#if PLATFORM_ANDROID
+    ADPFManager::getInstance().NotifyWorkload(EADPFWorkloadHint::Increase, bCPU, bGPU);
+#endif
+}
+
+void UAndroidPerformanceFunctionLibrary::NotifyWorkloadSpike(bool bCPU, bool bGPU)
+{
+#if PLATFORM_ANDROID
+    ADPFManager::getInstance().NotifyWorkload(EADPFWorkloadHint::Spike, bCPU, bGPU);
+#endif
+}
+
+void UAndroidPerformanceFunctionLibrary::NotifyWorkloadReset(bool bCPU, bool bGPU)
+{
+#if PLATFORM_ANDROID
+    ADPFManager::getInstance().NotifyWorkload(EADPFWorkloadHint::Reset, bCPU, bGPU);
+#endif
+}
+
+void UAndroidPerformanceFunctionLibrary::NotifyFirstInteractiveFrame()
+{
+#if PLATFORM_ANDROID
+    ADPFManager::getInstance().EndStartupBoost();
+#endif
+}
+
+void UAndroidPerformanceFunctionLibrary::SetExpectedSessionLength(float Seconds)
+{
+    ADPFManager::getInstance().SetExpectedSessionLength(Seconds);
+}
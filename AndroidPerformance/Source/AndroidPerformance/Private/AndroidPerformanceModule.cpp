@@ -20,6 +20,9 @@
 
 #include "AndroidPerformanceLog.h"
 #include "ADPFManager.h"
+#include "ADPFSoakBenchmark.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 
 IMPLEMENT_MODULE(FAndroidPerformanceModule, AndroidPerformance)
 
@@ -30,37 +33,83 @@ void FAndroidPerformanceModule::StartupModule()
 #if PLATFORM_ANDROID
     UE_LOG(LogAndroidPerformance, Log, TEXT("Android Performance Module Started"));
 
+    ADPFManager::getInstance().LoadDeviceProfile();
     bool isInitialized = ADPFManager::getInstance().registerListener();
+    initialized_ = isInitialized;
 
     // registration tick
     if(isInitialized)
     {
-        FWorldDelegates::OnWorldTickStart.AddRaw(this, &FAndroidPerformanceModule::Tick);
+        ADPFManager::getInstance().StartStartupBoost();
+        ADPFManager::getInstance().RegisterFrameHooks();
+        ADPFManager::getInstance().RegisterWorkloadHooks();
+        ADPFManager::getInstance().RegisterLifecycleHooks();
     }
     else
     {
         UE_LOG(LogAndroidPerformance, Log, TEXT("Android Performance is not initialized because of not supporint device"));
     }
+
+    // -ADPFThermalTraceRecord[=path] records the session for replays.
+    FString record_path;
+    if (FParse::Value(FCommandLine::Get(), TEXT("ADPFThermalTraceRecord="), record_path) ||
+            FParse::Param(FCommandLine::Get(), TEXT("ADPFThermalTraceRecord")))
+    {
+        ADPFManager::getInstance().StartThermalTraceRecording(record_path);
+    }
 #endif
+
+    // The ticker also runs replays where the listener isn't registered, so
+    // a replay started from the command line or the console advances.
+    tick_handle_ = FTSTicker::GetCoreTicker().AddTicker(
+            FTickerDelegate::CreateRaw(this, &FAndroidPerformanceModule::Tick));
+
+    // -ADPFThermalTraceReplay=path plays a recorded trace through the governor.
+    FString replay_path;
+    if (FParse::Value(FCommandLine::Get(), TEXT("ADPFThermalTraceReplay="), replay_path))
+    {
+        ADPFManager::getInstance().StartThermalTraceReplay(replay_path, false);
+    }
+
+    // -ADPFSoakBenchmark[=minutes] runs the soak benchmark and exits with
+    // the report, for automated runs.
+    float soak_minutes = 0.0f;
+    if (FParse::Value(FCommandLine::Get(), TEXT("ADPFSoakBenchmark="), soak_minutes) ||
+            FParse::Param(FCommandLine::Get(), TEXT("ADPFSoakBenchmark")))
+    {
+        ADPFSoakBenchmark::getInstance().Start(soak_minutes, true);
+    }
 }
 
 void FAndroidPerformanceModule::ShutdownModule()
 {
+    ADPFSoakBenchmark::getInstance().Stop();
+    ADPFManager::getInstance().UnregisterAllPolicies();
+
+    // unregistration tick
+    FTSTicker::GetCoreTicker().RemoveTicker(tick_handle_);
+    tick_handle_.Reset();
+
 #if PLATFORM_ANDROID
     UE_LOG(LogAndroidPerformance, Log, TEXT("Android Performance Module Shutdown"));
 
-    // unregistration tick
-    FWorldDelegates::OnWorldTickStart.RemoveAll(this);
+    ADPFManager::getInstance().UnregisterFrameHooks();
+    ADPFManager::getInstance().UnregisterWorkloadHooks();
+    ADPFManager::getInstance().UnregisterLifecycleHooks();
 
     ADPFManager::getInstance().unregisterListener();
 #endif
 }
 
-void FAndroidPerformanceModule::Tick(UWorld* world, ELevelTick tick_type, float delta_time)
+bool FAndroidPerformanceModule::Tick(float delta_time)
 {
-#if PLATFORM_ANDROID
-    ADPFManager::getInstance().Monitor();
-#endif
+    ADPFManager& manager = ADPFManager::getInstance();
+    if (initialized_ || manager.IsReplayingThermalTrace())
+    {
+        manager.Monitor();
+    }
+    // Keep ticking.
+    return true;
 }
 
 #undef LOGTEXT_NAMESPACE
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AndroidPerformanceSubsystem.h"
+#include "ADPFManager.h"
+
+void UAndroidPerformanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+    BudgetChangedHandle = ADPFManager::getInstance().OnBudgetChanged().AddUObject(
+            this, &UAndroidPerformanceSubsystem::HandleBudgetChanged);
+}
+
+void UAndroidPerformanceSubsystem::Deinitialize()
+{
+    ADPFManager::getInstance().OnBudgetChanged().Remove(BudgetChangedHandle);
+    BudgetChangedHandle.Reset();
+    Super::Deinitialize();
+}
+
+void UAndroidPerformanceSubsystem::HandleBudgetChanged(int32 QualityLevel, float Budget)
+{
+    OnBudgetChanged.Broadcast(QualityLevel, Budget);
+}
+
+float UAndroidPerformanceSubsystem::GetPerformanceBudget() const
+{
+    return GetBudget();
+}
+
+float UAndroidPerformanceSubsystem::ScaleByBudget(float MinValue, float MaxValue) const
+{
+    return FMath::Lerp(MinValue, MaxValue, GetBudget());
+}
+
+int32 UAndroidPerformanceSubsystem::GetQualityLevel() const
+{
+    return ADPFManager::getInstance().GetQualityLevel();
+}
+
+int32 UAndroidPerformanceSubsystem::GetThermalStatus() const
+{
+    return ADPFManager::getInstance().GetThermalStatus();
+}
+
+float UAndroidPerformanceSubsystem::GetThermalHeadroom() const
+{
+    return ADPFManager::getInstance().GetThermalHeadroom();
+}
+
+float UAndroidPerformanceSubsystem::GetBudget()
+{
+    return ADPFManager::getInstance().GetPerformanceBudget();
+}
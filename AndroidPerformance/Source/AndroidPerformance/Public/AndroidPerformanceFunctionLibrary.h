@@ -0,0 +1,55 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "AndroidPerformanceFunctionLibrary.generated.h"
+
+// Game code and Blueprint access to the Android Performance plugin. The
+// class exists on every platform, so Blueprints and game modules build for
+// the editor and desktop too. The hints do nothing there, and the session
+// length only feeds thermal trace replays.
+UCLASS()
+class ANDROIDPERFORMANCE_API UAndroidPerformanceFunctionLibrary : public UBlueprintFunctionLibrary
+{
+    GENERATED_BODY()
+
+public:
+    // The work is going to go up for a while, e.g. before streaming in a level.
+    UFUNCTION(BlueprintCallable, Category = "Android Performance")
+    static void NotifyWorkloadIncrease(bool bCPU = true, bool bGPU = true);
+
+    // A one off burst of work is coming, e.g. a shader compile.
+    UFUNCTION(BlueprintCallable, Category = "Android Performance")
+    static void NotifyWorkloadSpike(bool bCPU = true, bool bGPU = true);
+
+    // The work changed in a way the earlier frames don't predict, e.g. after
+    // a level transition.
+    UFUNCTION(BlueprintCallable, Category = "Android Performance")
+    static void NotifyWorkloadReset(bool bCPU = true, bool bGPU = true);
+
+    // The game is interactive, end the startup boost. Only needed with
+    // r.AndroidPerformanceStartupBoostEnd=1.
+    UFUNCTION(BlueprintCallable, Category = "Android Performance")
+    static void NotifyFirstInteractiveFrame();
+
+    // A session or match of this many seconds starts now. The planned
+    // quality mode, r.AndroidPerformanceChangeQualities=4, picks the
+    // highest quality level the device can sustain until it ends.
+    UFUNCTION(BlueprintCallable, Category = "Android Performance")
+    static void SetExpectedSessionLength(float Seconds);
+};
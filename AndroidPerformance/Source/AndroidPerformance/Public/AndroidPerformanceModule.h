@@ -17,6 +17,7 @@
 #pragma once
 
 #include "Modules/ModuleManager.h"
+#include "Containers/Ticker.h"
 
 class FAndroidPerformanceModule final : public IModuleInterface
 {
@@ -25,5 +26,13 @@ public:
     void StartupModule() override;
     void ShutdownModule() override;
 
-    void Tick(UWorld* world, ELevelTick tick_type, float delta_time);
+    // Core ticker callback. Unlike the world tick it runs once per engine
+    // frame, however many worlds tick, and also while no world ticks.
+    bool Tick(float delta_time);
+
+private:
+    FTSTicker::FDelegateHandle tick_handle_;
+    // Whether the thermal listener is registered. Without it, on other
+    // platforms or unsupported devices, only thermal trace replays tick.
+    bool initialized_ = false;
 };
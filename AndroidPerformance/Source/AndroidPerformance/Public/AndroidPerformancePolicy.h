@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Governor state a policy decides from, filled on the game thread once a
+// frame.
+struct FAndroidPerformancePolicyInput
+{
+    // Seconds since startup, the trace clock during a thermal trace replay.
+    double Clock = 0.0;
+    // Last frame time, and the frame rate it gives.
+    float FrameMs = 0.f;
+    float FPS = 0.f;
+    // Longest work duration of the game, render and RHI threads in the last
+    // frame, and the target duration of the hint sessions.
+    int64 WorkDurationNs = 0;
+    int64 TargetWorkDurationNs = 0;
+    // Present interval the target starts from, and the smoothed fraction of
+    // frames that missed it.
+    int64 FrameIntervalNs = 0;
+    float MissRate = 0.f;
+
+    // Latest thermal headroom, from 0 up to 1 where the device throttles
+    // severely, and the headroom predicted from the forecasts.
+    float ThermalHeadroom = 0.f;
+    float PredictedHeadroom = 0.f;
+    // AThermalStatus, from 0 (none) to 6 (shutdown).
+    int32 ThermalStatus = 0;
+    // CPU and GPU compute headroom from 0 to 100, Android 16 and later, -1
+    // until sampled.
+    float CPUHeadroom = -1.f;
+    float GPUHeadroom = -1.f;
+    // Memory pressure from 0 (none) to 3 (critical).
+    int32 MemoryPressure = 0;
+
+    // Current quality level, the number of levels, and the highest level the
+    // game mode and memory pressure allow.
+    int32 QualityLevel = 0;
+    int32 QualityLevelCount = 0;
+    int32 MaxQualityLevel = 0;
+    // Applied max FPS cap, and screen percentage of the resolution
+    // controller, 0 if none.
+    int32 FrameRateCap = 0;
+    float ScreenPercentage = 0.f;
+    // Seconds left of the expected session, see SetExpectedSessionLength().
+    float RemainingSessionSeconds = 0.f;
+
+    // A new thermal sample arrived since the last frame.
+    bool bNewThermalSample = false;
+    // The periodic quality update is due, every 15 seconds unless the device
+    // profile sets another interval.
+    bool bUpdateDue = false;
+};
+
+// What a policy wants changed. The defaults leave everything as it is.
+struct FAndroidPerformancePolicyDecision
+{
+    // Quality level to move to, INDEX_NONE to keep the current one. The caps,
+    // minimum dwell time and cool-down confirmation of the governor still
+    // apply.
+    int32 QualityLevel = INDEX_NONE;
+    // Max FPS cap, 0 for none, INDEX_NONE for r.AndroidPerformanceFrameRateCaps.
+    // The game mode cap still applies.
+    int32 FrameRateCap = INDEX_NONE;
+    // Screen percentage, 0 to leave it to the resolution controller.
+    float ScreenPercentage = 0.f;
+    // Hint session target duration as a fraction of the present interval,
+    // 0 to leave it to the missed deadline PID loop.
+    float TargetWorkScale = 0.f;
+};
+
+// A project's own governor policy. It replaces the built-in policy picked by
+// r.AndroidPerformanceChangeQualities while r.AndroidPerformancePolicy names
+// it. Called on the game thread.
+class ANDROIDPERFORMANCE_API IAndroidPerformancePolicy
+{
+public:
+    virtual ~IAndroidPerformancePolicy() = default;
+
+    // Called once a frame while the policy is selected. OutDecision starts
+    // from the defaults.
+    virtual void Decide(const FAndroidPerformancePolicyInput& Input, FAndroidPerformancePolicyDecision& OutDecision) = 0;
+
+    // Called when the policy gets selected, and before a thermal trace
+    // replay, to clear any state it keeps.
+    virtual void Reset() {}
+};
+
+// Registers project policies, e.g. from a game module's StartupModule().
+// The registry holds a reference to the policy, so the module that
+// implements it must call Unregister() from its ShutdownModule(), before its
+// code is unloaded. Game thread only.
+class ANDROIDPERFORMANCE_API FAndroidPerformancePolicyRegistry
+{
+public:
+    // A policy registered under an existing name replaces it.
+    static void Register(FName Name, TSharedRef<IAndroidPerformancePolicy> Policy);
+    static void Unregister(FName Name);
+};
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Subsystems/EngineSubsystem.h"
+#include "AndroidPerformanceSubsystem.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FAndroidPerformanceBudgetChanged, int32, QualityLevel, float, Budget);
+
+// Lets gameplay systems the plugin can't scale itself, e.g. AI tick rates,
+// crowd density or audio voices, follow the device's thermal state. The
+// performance budget goes from 1, full quality with thermal headroom to
+// spare, down to 0. It stays 1 on other platforms.
+UCLASS()
+class ANDROIDPERFORMANCE_API UAndroidPerformanceSubsystem : public UEngineSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+
+    // Called on the game thread when the quality level changes or the
+    // budget has moved by 0.05.
+    UPROPERTY(BlueprintAssignable, Category = "Android Performance")
+    FAndroidPerformanceBudgetChanged OnBudgetChanged;
+
+    // Updated once a frame. Cheap enough to read every tick, also from C++
+    // through GetBudget() without the subsystem.
+    UFUNCTION(BlueprintPure, Category = "Android Performance")
+    float GetPerformanceBudget() const;
+
+    // Lerp from MinValue at budget 0 to MaxValue at budget 1, e.g. a crowd
+    // size or a tick interval.
+    UFUNCTION(BlueprintPure, Category = "Android Performance")
+    float ScaleByBudget(float MinValue, float MaxValue) const;
+
+    // Current quality level, from 0 (lowest) to 3 (highest).
+    UFUNCTION(BlueprintPure, Category = "Android Performance")
+    int32 GetQualityLevel() const;
+
+    // AThermalStatus, from 0 (none) to 6 (shutdown).
+    UFUNCTION(BlueprintPure, Category = "Android Performance")
+    int32 GetThermalStatus() const;
+
+    UFUNCTION(BlueprintPure, Category = "Android Performance")
+    float GetThermalHeadroom() const;
+
+    // Any thread.
+    static float GetBudget();
+
+private:
+    void HandleBudgetChanged(int32 QualityLevel, float Budget);
+
+    FDelegateHandle BudgetChangedHandle;
+};